@@ -0,0 +1,128 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/*
+ * Minimal Google Benchmark style harness: every benchmark is calibrated until it
+ * runs for at least `minTime` seconds, results are printed as a table and can be
+ * written as Google Benchmark compatible JSON to compare commits
+ * (ex. with compare.py from the benchmark repository, or a plain diff).
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <vector>
+
+
+// Keeps the compiler from dropping a result
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct BenchResult
+{
+    std::string name;
+    uint64_t    iterations;
+    double      realNs;     // per iteration
+    double      cpuNs;      // per iteration
+
+    std::vector<std::pair<std::string, double>> counters;  // extra values, written as JSON keys
+};
+
+class BenchRunner
+{
+    public:
+        explicit BenchRunner(double minTime = 0.2) : m_minTime(minTime) {}
+
+        // Only benchmarks whose name contains `filter` are run
+        void setFilter(const std::string& filter) { m_filter = filter; }
+
+        template <typename F>
+        void run(const std::string& name, F body)
+        {
+            if (!m_filter.empty() && name.find(m_filter) == std::string::npos) return;
+
+            // Grow the iteration count until a run is long enough to be timed
+            uint64_t iterations = 1;
+            double real = 0, cpu = 0;
+            while (true)
+            {
+                measure(body, iterations, real, cpu);
+                if (real >= m_minTime || iterations >= (uint64_t(1) << 40)) break;
+
+                double scale = (real > 0) ? (m_minTime * 1.4 / real) : 10;
+                iterations = std::max<uint64_t>(iterations + 1, uint64_t(iterations * std::min(scale, 10.0)));
+            }
+
+            addResult({name, iterations, real * 1e9 / iterations, cpu * 1e9 / iterations, {}});
+        }
+
+        // For benchmarks that time themselves (ex. end to end runs)
+        void addResult(const BenchResult& result)
+        {
+            std::printf("%-48s %14.1f ns %14.1f ns %12llu", result.name.c_str(), result.realNs, result.cpuNs, (unsigned long long)result.iterations);
+            for (const std::pair<std::string, double>& counter : result.counters)
+                std::printf("  %s=%.1f", counter.first.c_str(), counter.second);
+            std::printf("\n");
+            m_results.push_back(result);
+        }
+
+        void printHeader() const
+        {
+            std::printf("%-48s %17s %17s %12s\n", "Benchmark", "Time", "CPU", "Iterations");
+            std::printf("%s\n", std::string(97, '-').c_str());
+        }
+
+        // @return false if `path` cannot be written
+        bool writeJson(const std::string& path) const
+        {
+            FILE* file = std::fopen(path.c_str(), "w");
+            if (!file) return false;
+
+            char date[32];
+            std::time_t now = std::time(nullptr);
+            std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+            // `make bench` passes the commit in BENCH_COMMIT
+            const char* commit = std::getenv("BENCH_COMMIT");
+
+            std::fprintf(file, "{\n  \"context\": {\n    \"date\": \"%s\",\n    \"commit\": \"%s\",\n    \"library_build_type\": \"release\"\n  },\n", date, commit ? commit : "unknown");
+            std::fprintf(file, "  \"benchmarks\": [\n");
+            for (size_t i = 0; i < m_results.size(); i++)
+            {
+                const BenchResult& r = m_results[i];
+                std::fprintf(file, "    {\"name\": \"%s\", \"run_type\": \"iteration\", \"iterations\": %llu, \"real_time\": %.3f, \"cpu_time\": %.3f, \"time_unit\": \"ns\"",
+                             r.name.c_str(), (unsigned long long)r.iterations, r.realNs, r.cpuNs);
+                for (const std::pair<std::string, double>& counter : r.counters)
+                    std::fprintf(file, ", \"%s\": %.3f", counter.first.c_str(), counter.second);
+                std::fprintf(file, "}%s\n", (i + 1 < m_results.size()) ? "," : "");
+            }
+            std::fprintf(file, "  ]\n}\n");
+            std::fclose(file);
+            return true;
+        }
+    private:
+        template <typename F>
+        static void measure(F& body, uint64_t iterations, double& real, double& cpu)
+        {
+            std::clock_t cpuStart = std::clock();
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+            for (uint64_t i = 0; i < iterations; i++) body();
+
+            real = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            cpu  = double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+        }
+
+        double                   m_minTime;     // in seconds
+        std::string              m_filter;
+        std::vector<BenchResult> m_results;
+};
+
+#endif // BENCH_H
@@ -0,0 +1,93 @@
+/*
+ * Compares the `words` decode/encode paths on a Push_Report sized field
+ * (accumulated_data: 90 bytes, 45 words).
+ *
+ * Build and run with `make bench`
+ */
+#include "../src/parser/byte_order.h"
+#include "../src/parser/msg.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#define FIELD_WORDS 45
+#define ITERATIONS  1000000
+
+// Previous getField<std::vector<uint16_t>> path: a 2 byte vector and a reversing copy per word
+template<typename T>
+T legacyStitchIntBytes(std::vector<BYTE> bytes)
+{
+    T stichedInt;
+    std::reverse(bytes.begin(), bytes.end());
+    std::memcpy(&stichedInt, bytes.data(), sizeof(T));
+    return stichedInt;
+}
+
+static std::vector<uint16_t> legacyDecode(const std::vector<BYTE>& bytes)
+{
+    std::vector<uint16_t> result(bytes.size() / 2, 0);
+    for (size_t i = 0; i < bytes.size() / 2; i++)
+    {
+        std::vector<BYTE> currentTwoBytes = {bytes[i*2], bytes[i*2+1]};
+        result[i] = legacyStitchIntBytes<uint16_t>(currentTwoBytes);
+    }
+    return result;
+}
+
+// Previous setField path: one fetchBytes() vector per word
+static void legacyEncode(const uint16_t* words, BYTE* out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        std::vector<BYTE> bytes = fetchBytes(words[i], 2, false);
+        out[i*2]     = bytes[0];
+        out[i*2 + 1] = bytes[1];
+    }
+}
+
+template <typename F>
+static double nsPerOp(F body)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) body();
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / ITERATIONS;
+}
+
+int main()
+{
+    std::vector<BYTE> packet(FIELD_WORDS * 2);
+    for (size_t i = 0; i < packet.size(); i++) packet[i] = BYTE(i * 7 + 1);
+
+    uint16_t words[FIELD_WORDS];
+    BYTE     encoded[FIELD_WORDS * 2];
+    volatile uint16_t sink = 0;
+
+    // Sanity check before timing anything
+    decodeWords(packet.data(), words, FIELD_WORDS);
+    std::vector<uint16_t> expected = legacyDecode(packet);
+    for (int i = 0; i < FIELD_WORDS; i++)
+        if (words[i] != expected[i]) {std::printf("ERROR: decodeWords() mismatch at word %d\n", i); return 1;}
+    encodeWords(words, encoded, FIELD_WORDS);
+    if (std::memcmp(encoded, packet.data(), packet.size())) {std::printf("ERROR: encodeWords() mismatch\n"); return 1;}
+
+    std::printf("decode %d words, legacy vectors : %8.1f ns\n", FIELD_WORDS, nsPerOp([&]() { sink = sink + legacyDecode(packet)[FIELD_WORDS-1]; }));
+    std::printf("decode %d words, scalar bswap   : %8.1f ns\n", FIELD_WORDS, nsPerOp([&]() {
+        for (int i = 0; i < FIELD_WORDS; i++) words[i] = loadBigEndian<uint16_t>(packet.data() + i*2);
+        sink = sink + words[FIELD_WORDS-1];
+    }));
+    std::printf("decode %d words, decodeWords()  : %8.1f ns\n", FIELD_WORDS, nsPerOp([&]() {
+        decodeWords(packet.data(), words, FIELD_WORDS);
+        sink = sink + words[FIELD_WORDS-1];
+    }));
+    std::printf("encode %d words, legacy vectors : %8.1f ns\n", FIELD_WORDS, nsPerOp([&]() {
+        legacyEncode(words, encoded, FIELD_WORDS);
+        sink = sink + encoded[0];
+    }));
+    std::printf("encode %d words, encodeWords()  : %8.1f ns\n", FIELD_WORDS, nsPerOp([&]() {
+        encodeWords(words, encoded, FIELD_WORDS);
+        sink = sink + encoded[0];
+    }));
+    return 0;
+}
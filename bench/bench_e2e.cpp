@@ -0,0 +1,129 @@
+/*
+ * End to end benchmark of MessageInstance::sendMessage(): the real serial engine
+ * talks to a minimal responder through a PTY pair, configured by openComm() like
+ * a USB adapter. Reports commands/sec, p50/p99 round trip and CPU per command for a
+ * short exchange (Version_Command -> Version_Report) and a large report
+ * (Push Command -> Push_Report, 0xEE bytes).
+ *
+ * The responder delays every reply by the time both packets would take on the wire
+ * at BAUD_RATE (11 bits per byte), --no-pace replies immediately to isolate the
+ * engine's own overhead.
+ *
+ * --device <tty> talks to a real base on a USB adapter instead of the PTY, and
+ * --low-latency calls setLowLatency() on the port first (ASYNC_LOW_LATENCY and the
+ * adapter's latency timer, see LOW_LATENCY): run both ways to see what it saves.
+ * --serial-thread runs the exchanges on the SerialThread with the SERIAL_THREAD_* settings
+ * (SCHED_FIFO, pinning, locked memory), compare its p99 with a run without it for the jitter.
+ *
+ * Build and run with `make bench-e2e` (Linux only)
+ * ./bench/bench_e2e [--count <commands>] [--no-pace] [--device <tty>] [--low-latency] [--serial-thread] [--json <file>]
+ */
+#include "bench.h"
+#include "pty_responder.h"
+
+#define BENCH_XML   "dtCommandsTMEV.xml"
+
+INITIALIZE_EASYLOGGINGPP
+
+MessageTable table;
+
+static const char* EXCHANGES[][2] = {
+    {"Version_Command", "Version_Report"},
+    {"Push Command",    "Push_Report"}
+};
+
+int main(int argc, char** argv)
+{
+    std::string jsonPath, device;
+    int  count      = 100;
+    bool pace       = true;
+    bool lowLatency = false;
+    bool realtime   = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if      (!strcmp(argv[i], "--count") && i + 1 < argc) count    = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--json")  && i + 1 < argc) jsonPath = argv[++i];
+        else if (!strcmp(argv[i], "--device") && i + 1 < argc) device  = argv[++i];
+        else if (!strcmp(argv[i], "--no-pace"))               pace     = false;
+        else if (!strcmp(argv[i], "--low-latency"))           lowLatency = true;
+        else if (!strcmp(argv[i], "--serial-thread"))         realtime   = true;
+    }
+    count = std::max(count, 1);
+
+    std::string xml = BENCH_XML;
+    if (!loadDocument(xml, table)) return 1;
+
+    // PTY pair: the engine opens the slave like a USB adapter, the responder owns the master
+    int master = -1;
+    if (device.empty())
+    {
+        master = openPtyMaster();
+        if (master < 0) return 1;
+        device = ptsname(master);
+    }
+
+    if (!openComm(device)) return 1;
+    if (lowLatency) setLowLatency(device);
+    if (realtime && !serialThread.start({SERIAL_THREAD_PRIORITY, SERIAL_THREAD_CPU, SERIAL_THREAD_MLOCK})) return 1;
+
+    Responder responder(master, pace);
+    if (master >= 0)
+    {
+        for (const char** exchange : EXCHANGES)
+        {
+            MessageInstance reply(table.findMessage(exchange[1]));   // DefaultData
+            responder.addReply(table.findMessage(exchange[0]), reply);
+        }
+        responder.start();
+    }
+
+    BenchRunner runner;
+    std::string mode = (master < 0) ? "base on " + device : (pace ? "paced at " + std::to_string(BAUD_RATE) + " baud" : "unpaced");
+    std::printf("%d commands per exchange, %s%s%s\n", count, mode.c_str(), lowLatency ? ", low latency" : "", realtime ? ", serial thread" : "");
+    runner.printHeader();
+
+    bool ok = true;
+    for (const char** exchange : EXCHANGES)
+    {
+        MessageInstance command(table.findMessage(exchange[0]));
+        MessageInstance response;
+        const Message*  expected = table.findMessage(exchange[1]);
+
+        std::vector<uint64_t> latencies;
+        latencies.reserve(count);
+        int failures = 0;
+
+        uint64_t cpuStart = threadCpuNanos();
+        uint64_t start    = monotonicNanos();
+        for (int i = 0; i < count; i++)
+        {
+            uint64_t sent = monotonicNanos();
+            comm_error status = command.sendMessage(&response);
+            latencies.push_back(monotonicNanos() - sent);
+
+            if (status != NONE || response.getSchema() != expected) failures++;
+        }
+        double elapsed = double(monotonicNanos() - start);
+        double cpu     = double(threadCpuNanos() - cpuStart);
+
+        std::sort(latencies.begin(), latencies.end());
+        BenchResult result = {std::string("sendMessage/") + exchange[0], uint64_t(count), elapsed / count, cpu / count, {}};
+        result.counters.push_back({"commands_per_second", count * 1e9 / elapsed});
+        result.counters.push_back({"p50_ns", double(latencies[latencies.size() / 2])});
+        result.counters.push_back({"p99_ns", double(latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)])});
+        result.counters.push_back({"failures", double(failures)});
+        runner.addResult(result);
+
+        if (failures) ok = false;
+    }
+
+    serialThread.stop();
+    if (master >= 0)
+    {
+        responder.stop();
+        close(master);
+    }
+
+    if (!jsonPath.empty() && !runner.writeJson(jsonPath)) {std::printf("ERROR: Could not write '%s'\n", jsonPath.c_str()); return 1;}
+    return ok ? 0 : 1;
+}
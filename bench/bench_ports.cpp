@@ -0,0 +1,165 @@
+/*
+ * Many ports benchmark: one host driving `--ports` bases (16 by default), each a PTY
+ * pair with its own simulated base, through the two paths the engine has:
+ *
+ *   blocking/<n>_ports : sendMessage() on one port after the other (serialComm pointed at
+ *                        each port in turn), the blocking read()/write() path of main.cpp,
+ *                        each step waiting on the port (VTIME), no sleep between steps
+ *   uring/<n>_ports    : UringComm, an exchange in flight on every port at once
+ *
+ * Every round sends Version_Command on every port. Reports exchanges/sec, p50/p99 time of a
+ * round and CPU of the calling thread per exchange (blocked io_uring workers are not counted).
+ *
+ * Build and run with `make bench-ports` (Linux only)
+ * ./bench/bench_ports [--ports <n>] [--rounds <n>] [--no-pace] [--json <file>]
+ */
+#include "bench.h"
+#include "pty_responder.h"
+#include "../src/serial/uring_comm.h"
+
+#include <memory>
+
+#define BENCH_XML   "dtCommandsTMEV.xml"
+#define COMMAND     "Version_Command"
+#define REPORT      "Version_Report"
+
+INITIALIZE_EASYLOGGINGPP
+
+MessageTable table;
+
+struct RoundStats
+{
+    std::vector<uint64_t> rounds;   // ns per round
+    uint64_t              elapsed;
+    uint64_t              cpu;
+    int                   failures;
+};
+
+static BenchResult makeResult(const std::string& name, const RoundStats& stats, int ports)
+{
+    std::vector<uint64_t> rounds = stats.rounds;
+    std::sort(rounds.begin(), rounds.end());
+
+    uint64_t exchanges = uint64_t(rounds.size()) * ports;
+    BenchResult result = {name, exchanges, double(stats.elapsed) / exchanges, double(stats.cpu) / exchanges, {}};
+    result.counters.push_back({"exchanges_per_second", exchanges * 1e9 / stats.elapsed});
+    result.counters.push_back({"round_p50_ns", double(rounds[rounds.size() / 2])});
+    result.counters.push_back({"round_p99_ns", double(rounds[std::min(rounds.size() - 1, rounds.size() * 99 / 100)])});
+    result.counters.push_back({"failures", double(stats.failures)});
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    std::string jsonPath;
+    int  ports  = 16;
+    int  rounds = 3;
+    bool pace   = true;
+    for (int i = 1; i < argc; i++)
+    {
+        if      (!strcmp(argv[i], "--ports")  && i + 1 < argc) ports    = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--rounds") && i + 1 < argc) rounds   = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--json")   && i + 1 < argc) jsonPath = argv[++i];
+        else if (!strcmp(argv[i], "--no-pace"))                pace     = false;
+    }
+    ports  = std::max(ports, 1);
+    rounds = std::max(rounds, 1);
+
+    std::string xml = BENCH_XML;
+    if (!loadDocument(xml, table)) return 1;
+
+    const Message*  expected = table.findMessage(REPORT);
+    MessageInstance command(table.findMessage(COMMAND));
+    MessageInstance reply(expected);    // DefaultData
+
+    // One simulated base per port
+    std::vector<int>                        masters;
+    std::vector<std::unique_ptr<Responder>> responders;
+    for (int i = 0; i < ports; i++)
+    {
+        int master = openPtyMaster();
+        if (master < 0) return 1;
+
+        masters.push_back(master);
+        responders.emplace_back(new Responder(master, pace));
+        responders.back()->addReply(command.getSchema(), reply);
+        responders.back()->start();
+    }
+
+    BenchRunner runner;
+    std::printf("%d ports, %d rounds, %s\n", ports, rounds, pace ? ("paced at " + std::to_string(BAUD_RATE) + " baud").c_str() : "unpaced");
+    runner.printHeader();
+
+    bool ok = true;
+    MessageInstance response;
+
+    // Blocking path: the single serialComm, pointed at one port after the other
+    {
+        std::vector<uint64_t> fds;
+        for (int master : masters)
+        {
+            if (!openComm(ptsname(master))) return 1;
+            fds.push_back(serialComm.fileDescriptor);
+        }
+
+        RoundStats stats = {{}, 0, 0, 0};
+        uint64_t cpuStart = threadCpuNanos();
+        uint64_t start    = monotonicNanos();
+        for (int round = 0; round < rounds; round++)
+        {
+            uint64_t roundStart = monotonicNanos();
+            for (uint64_t fd : fds)
+            {
+                serialComm.fileDescriptor = fd;
+                if (command.sendMessage(&response) != NONE || response.getSchema() != expected) stats.failures++;
+            }
+            stats.rounds.push_back(monotonicNanos() - roundStart);
+        }
+        stats.elapsed = monotonicNanos() - start;
+        stats.cpu     = threadCpuNanos() - cpuStart;
+
+        for (uint64_t fd : fds) close(int(fd));
+        runner.addResult(makeResult("blocking/" + std::to_string(ports) + "_ports", stats, ports));
+        if (stats.failures) ok = false;
+    }
+
+    // io_uring path: every port in flight at once
+    {
+        UringComm ring;
+        std::vector<int> ids;
+        for (int master : masters)
+        {
+            int id = ring.addPort(ptsname(master));
+            if (id < 0) {std::printf("ERROR: UringComm unavailable, skipped\n"); ok = false; break;}
+            ids.push_back(id);
+        }
+
+        if (int(ids.size()) == ports)
+        {
+            RoundStats stats = {{}, 0, 0, 0};
+            uint64_t cpuStart = threadCpuNanos();
+            uint64_t start    = monotonicNanos();
+            for (int round = 0; round < rounds; round++)
+            {
+                uint64_t roundStart = monotonicNanos();
+                for (int id : ids) ring.start(id, command);
+                ring.run();
+                stats.rounds.push_back(monotonicNanos() - roundStart);
+
+                for (int id : ids)
+                    if (ring.finish(id, &response) != NONE || response.getSchema() != expected) stats.failures++;
+            }
+            stats.elapsed = monotonicNanos() - start;
+            stats.cpu     = threadCpuNanos() - cpuStart;
+
+            runner.addResult(makeResult("uring/" + std::to_string(ports) + "_ports", stats, ports));
+            if (stats.failures) ok = false;
+        }
+    }
+
+    for (std::unique_ptr<Responder>& responder : responders) responder->stop();
+    for (int master : masters) close(master);
+
+    if (!jsonPath.empty() && !runner.writeJson(jsonPath)) {std::printf("ERROR: Could not write '%s'\n", jsonPath.c_str()); return 1;}
+    return ok ? 0 : 1;
+}
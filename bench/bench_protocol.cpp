@@ -0,0 +1,211 @@
+/*
+ * Microbenchmarks of the protocol stack on the real XML files in src/xml:
+ * loading, lookups, field access per type, packet building and the receive path.
+ *
+ * Build and run with `make bench`, results are also written to bench/bench_protocol.json.
+ * ./bench/bench_protocol [--json <file>] [--filter <substring>] [--min-time <seconds>]
+ */
+#include "bench.h"
+#include "../src/serial/lf_comm.h"
+
+#include <cstring>
+#include <map>
+
+#if defined(__linux__)
+    #include <fcntl.h>
+#endif
+
+#define BENCH_XML       "dtCommandsTMEV.xml"    // used by everything but the load benchmarks
+#define SMALL_REPORT    "Version_Report"
+#define LARGE_REPORT    "Push_Report"
+
+INITIALIZE_EASYLOGGINGPP
+
+MessageTable table;
+
+static const char* XML_FILES[] = {
+    "dtCommandsIMDB.xml", "dtCommandsIMDB_TE.xml", "dtCommandsMM.xml", "dtCommandsPM.xml", "dtCommandsPM_TE.xml",
+    "dtCommandsPNC.xml", "dtCommandsPNC_TE.xml", "dtCommandsRCB.xml", "dtCommandsRCB_TE.xml", "dtCommandsTM.xml",
+    "dtCommandsTMEV.xml", "dtCommandsTMEV_TE.xml", "dtCommandsTMInt.xml", "dtCommandsTMInt_TE.xml", "dtCommandsTM_TE.xml"
+};
+
+// Writes the full packet of `instance` (header, data, checksum) into `out`, @return its length
+static int buildPacket(const MessageInstance& instance, BYTE* out)
+{
+    std::vector<BYTE> packet = instance.getMessageBuffer();
+    std::copy(packet.begin(), packet.end(), out);
+    return int(packet.size());
+}
+
+// First field of every type, among outgoing messages if `outgoing`
+static std::map<MessageField::PacketItem_t, std::pair<const Message*, std::string>> fieldsByType(bool outgoing)
+{
+    std::map<MessageField::PacketItem_t, std::pair<const Message*, std::string>> found;
+    for (const std::pair<const std::string, Message*>& entry : table.getMsgTable())
+    {
+        const Message* msg = entry.second;
+        if (outgoing && !msg->isEditable()) continue;
+
+        for (const MessageField& field : msg->getDataFormat())
+            if (field.getSize() > 0 && !found.count(field.getTypeEnum()))
+                found[field.getTypeEnum()] = {msg, std::string(field.getName())};
+    }
+    return found;
+}
+
+static void benchLoad(BenchRunner& runner)
+{
+    // Duplicate tag warnings (RCB) would be printed on every iteration
+    std::streambuf* console = std::cout.rdbuf(nullptr);
+
+    for (const char* file : XML_FILES)
+    {
+        runner.run(std::string("xml_load/") + file, [&]
+        {
+            MessageTable loaded;
+            std::string path = file;
+            doNotOptimize(loadDocument(path, loaded));
+        });
+    }
+
+    std::cout.rdbuf(console);
+    std::cout.clear();
+}
+
+static void benchLookups(BenchRunner& runner)
+{
+    const Message* report = table.findMessage(LARGE_REPORT);
+    std::string name(report->getMsgName());
+    std::string tag(report->getSearchTag());
+
+    runner.run("lookup/findMessage", [&] { doNotOptimize(table.findMessage(name)); });
+    runner.run("lookup/findMessageByTag", [&] { doNotOptimize(table.findMessageByTag(tag)); });
+    runner.run("lookup/findMessageByHeader", [&] { doNotOptimize(table.findMessageByHeader(report->getHeader())); });
+    runner.run("lookup/findMessageField", [&] { doNotOptimize(report->findMessageField(std::string(report->getDataFormat()[0].getName()))); });
+}
+
+template <typename T>
+static void benchGet(BenchRunner& runner, const std::pair<const Message*, std::string>& target, const char* typeName)
+{
+    MessageInstance instance(target.first);
+    runner.run(std::string("getField/") + typeName, [&] { doNotOptimize(instance.getField<T>(target.second)); });
+}
+
+template <typename T>
+static void benchSet(BenchRunner& runner, const std::pair<const Message*, std::string>& target, const char* typeName)
+{
+    MessageInstance instance(target.first);
+    T value = T(0x5A);
+    runner.run(std::string("setField/") + typeName, [&] { doNotOptimize(instance.setField(target.second, value)); value++; });
+}
+
+static void benchFields(BenchRunner& runner)
+{
+    typedef MessageField F;
+    std::map<F::PacketItem_t, std::pair<const Message*, std::string>> readable = fieldsByType(false);
+    std::map<F::PacketItem_t, std::pair<const Message*, std::string>> writable = fieldsByType(true);
+
+    if (readable.count(F::byte))        benchGet<BYTE>(runner, readable[F::byte], "byte");
+    if (readable.count(F::bitfield))    benchGet<BYTE>(runner, readable[F::bitfield], "bitfield");
+    if (readable.count(F::signedByte))  benchGet<int8_t>(runner, readable[F::signedByte], "signed_byte");
+    if (readable.count(F::word))        benchGet<uint16_t>(runner, readable[F::word], "word");
+    if (readable.count(F::signedWord))  benchGet<int16_t>(runner, readable[F::signedWord], "signed_word");
+    if (readable.count(F::longInt))     benchGet<uint32_t>(runner, readable[F::longInt], "long");
+    if (readable.count(F::long_long))   benchGet<uint64_t>(runner, readable[F::long_long], "long_long");
+    if (readable.count(F::string))      benchGet<std::string>(runner, readable[F::string], "string");
+    if (readable.count(F::bytes))       benchGet<const BYTE*>(runner, readable[F::bytes], "bytes");
+    if (readable.count(F::words))       benchGet<std::vector<uint16_t>>(runner, readable[F::words], "words");
+
+    if (readable.count(F::word))
+    {
+        const std::pair<const Message*, std::string>& target = readable[F::word];
+        MessageInstance instance(target.first);
+        FieldHandle handle = target.first->getFieldHandle(target.second);
+        runner.run("getValue/word_handle", [&] { doNotOptimize(instance.getValue(handle)); });
+    }
+
+    if (writable.count(F::byte))        benchSet<BYTE>(runner, writable[F::byte], "byte");
+    if (writable.count(F::bitfield))    benchSet<BYTE>(runner, writable[F::bitfield], "bitfield");
+    if (writable.count(F::signedByte))  benchSet<int8_t>(runner, writable[F::signedByte], "signed_byte");
+    if (writable.count(F::word))        benchSet<uint16_t>(runner, writable[F::word], "word");
+    if (writable.count(F::signedWord))  benchSet<int16_t>(runner, writable[F::signedWord], "signed_word");
+    if (writable.count(F::longInt))     benchSet<uint32_t>(runner, writable[F::longInt], "long");
+    if (writable.count(F::long_long))   benchSet<uint64_t>(runner, writable[F::long_long], "long_long");
+}
+
+static void benchPackets(BenchRunner& runner)
+{
+    for (const char* name : {SMALL_REPORT, LARGE_REPORT})
+    {
+        MessageInstance instance(table.findMessage(name));
+        runner.run(std::string("getMessageBuffer/") + name, [&] { doNotOptimize(instance.getMessageBuffer()); });
+        runner.run(std::string("getChecksum/") + name, [&] { doNotOptimize(instance.getChecksum()); });
+
+        buildPacket(instance, serialComm.inBuffer);
+        runner.run(std::string("validateChecksum/") + name, [&] { doNotOptimize(validateChecksum()); });
+    }
+}
+
+static void benchReceive(BenchRunner& runner)
+{
+    for (const char* name : {SMALL_REPORT, LARGE_REPORT})
+    {
+        MessageInstance response;
+        BYTE packet[0x100];
+        int length = buildPacket(MessageInstance(table.findMessage(name)), packet);
+
+        std::memcpy(serialComm.inBuffer, packet, length);
+        runner.run(std::string("handleResponse/") + name, [&] { doNotOptimize(handleResponse(&response)); });
+
+#if defined(__linux__)
+        // Framing: commRead() pulling the packet out of a pipe until it is complete
+        int fds[2];
+        if (pipe(fds) != 0) continue;
+
+        uint64_t fileDescriptor = serialComm.fileDescriptor;
+        serialComm.fileDescriptor = fds[0];
+        serialComm.verbose = 0;
+
+        runner.run(std::string("framing/commRead_pipe/") + name, [&]
+        {
+            doNotOptimize(write(fds[1], packet, length));
+            serialComm.head = 0;
+            serialComm.errorState = NONE;
+            serialComm.mode = READING;
+            while (serialComm.mode != DONE) commRead();
+        });
+
+        serialComm.fileDescriptor = fileDescriptor;
+        close(fds[0]);
+        close(fds[1]);
+#endif
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string jsonPath, filter;
+    double minTime = 0.2;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if      (!strcmp(argv[i], "--json"))     jsonPath = argv[i + 1];
+        else if (!strcmp(argv[i], "--filter"))   filter   = argv[i + 1];
+        else if (!strcmp(argv[i], "--min-time")) minTime  = atof(argv[i + 1]);
+    }
+
+    std::string xml = BENCH_XML;
+    if (!loadDocument(xml, table)) return 1;
+
+    BenchRunner runner(minTime);
+    runner.setFilter(filter);
+    runner.printHeader();
+
+    benchLoad(runner);
+    benchLookups(runner);
+    benchFields(runner);
+    benchPackets(runner);
+    benchReceive(runner);
+
+    if (!jsonPath.empty() && !runner.writeJson(jsonPath)) {std::printf("ERROR: Could not write '%s'\n", jsonPath.c_str()); return 1;}
+    return 0;
+}
@@ -0,0 +1,109 @@
+#ifndef PTY_RESPONDER_H
+#define PTY_RESPONDER_H
+
+/*
+ * Simulated base for the end to end benchmarks (Linux): the engine opens the
+ * slave side of a PTY like a USB adapter, a Responder answers on the master side.
+ */
+
+#include "bench.h"
+#include "../src/serial/lf_comm.h"
+
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <thread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+
+#define BYTE_BITS   11      // start, 8 data, parity (mark/space), stop
+
+// Raw PTY master, its slave is ptsname(master)
+// @return -1 (after printing why) on failure
+inline int openPtyMaster()
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) || unlockpt(master)) {std::printf("ERROR: Could not create a PTY: %s\n", strerror(errno)); return -1;}
+
+    struct termios raw;
+    tcgetattr(master, &raw);
+    cfmakeraw(&raw);
+    tcsetattr(master, TCSANOW, &raw);
+    return master;
+}
+
+/*
+ * Base side of the PTY: answers every complete command packet with the packet
+ * registered for its header (target, sender, message id).
+ */
+class Responder
+{
+    public:
+        Responder(int master, bool pace) : m_master(master), m_pace(pace), m_stop(false) {}
+
+        void addReply(const Message* command, const MessageInstance& reply)
+        {
+            const BYTE* header = command->getHeader();
+            m_replies[key(header[TARGET_IDX], header[SOURCE_IDX], header[MSG_ID_IDX])] = reply.getMessageBuffer();
+        }
+
+        void start() { m_thread = std::thread(&Responder::loop, this); }
+        void stop()  { m_stop = true; m_thread.join(); }
+    private:
+        static uint32_t key(BYTE target, BYTE sender, BYTE id) { return (uint32_t(target) << 16) | (uint32_t(sender) << 8) | id; }
+
+        void loop()
+        {
+            BYTE buffer[0x200];
+            int  length = 0;
+
+            while (!m_stop)
+            {
+                pollfd pfd = {m_master, POLLIN, 0};
+                if (poll(&pfd, 1, 50) <= 0) continue;
+
+                int count = read(m_master, buffer + length, sizeof(buffer) - length);
+                if (count <= 0) continue;
+                length += count;
+
+                // Whole command received: reply and drop it
+                while (length > PACKLEN_IDX && length >= buffer[PACKLEN_IDX] && buffer[PACKLEN_IDX] >= MIN_PACK_LEN)
+                {
+                    int packetLength = buffer[PACKLEN_IDX];
+                    std::map<uint32_t, std::vector<BYTE>>::const_iterator reply =
+                        m_replies.find(key(buffer[TARGET_IDX], buffer[SOURCE_IDX], buffer[MSG_ID_IDX]));
+
+                    if (reply != m_replies.end())
+                    {
+                        if (m_pace)
+                        {
+                            uint64_t wireBits = uint64_t(packetLength + reply->second.size()) * BYTE_BITS;
+                            std::this_thread::sleep_for(std::chrono::microseconds(wireBits * 1000000 / BAUD_RATE));
+                        }
+                        doNotOptimize(write(m_master, reply->second.data(), reply->second.size()));
+                    }
+
+                    std::memmove(buffer, buffer + packetLength, length - packetLength);
+                    length -= packetLength;
+                }
+            }
+        }
+
+        int                                     m_master;
+        bool                                    m_pace;
+        std::atomic<bool>                       m_stop;
+        std::thread                             m_thread;
+        std::map<uint32_t, std::vector<BYTE>>   m_replies;
+};
+
+// CPU time of the calling thread
+inline uint64_t threadCpuNanos()
+{
+    struct timespec tsp;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &tsp);
+    return uint64_t(tsp.tv_sec)*1000000000 + uint64_t(tsp.tv_nsec);
+}
+
+#endif // PTY_RESPONDER_H
@@ -10,9 +10,10 @@ typedef uint16_t                WORD;
 typedef std::string             STRING;
 typedef uint32_t                LONG_INT;
 typedef int16_t                 SIGNED_WORD;
-typedef uint8_t*                BYTES;
+typedef const uint8_t*          BYTES;
 typedef std::vector<uint16_t>   WORDS;
 typedef uint64_t                LONG_LONG;
+typedef int8_t                  SIGNED_BYTE;
 
 /***************** XML *****************/
 STRING xmlFile = "dtCommandsTMEV.xml";
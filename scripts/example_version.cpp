@@ -0,0 +1,25 @@
+#include "../src/host/script_api.h"
+
+/*
+ * Example script for the host: asks for the firmware version every second.
+ * Edit, then `make scripts/example_version.so` while ./host is running.
+ */
+
+BASECOMM_SCRIPT(ctx)
+{
+    const Message* version = ctx.table->lookupMessage("Version_Command");
+    if (!version) {std::cout << "ERROR: Version_Command not in the XML\n"; return 1;}
+
+    MessageInstance cmd(version);
+    MessageInstance rsp;
+
+    while (!ctx.shouldStop())
+    {
+        comm_error error = cmd.sendMessage(&rsp);
+        if (error != NONE) {std::cout << "ERROR: Version_Command failed (" << error << ")\n"; return 1;}
+
+        rsp.printMsg();
+        if (!ctx.wait(1000)) break;
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include "script_host.h"
+
+#include <csignal>
+#include <sys/stat.h>
+using namespace std;
+INITIALIZE_EASYLOGGINGPP
+
+MessageTable table;
+
+/*
+ * Script host: opens the serial port, loads the XML and starts the logger once,
+ * then runs a script built with `make scripts/<name>.so`. Whenever the .so is
+ * rebuilt the running script is asked to stop (ScriptContext::shouldStop()),
+ * the new one is loaded and run again, without reopening the port.
+ *
+ *      ./host [--xml dtCommandsTMEV.xml] scripts/example.so /dev/ttyUSB0 [-v]
+ */
+
+#define POLL_MS 200     // how often the script file is checked for changes
+
+static atomic<bool> stopScript(false);
+static atomic<bool> quitHost(false);
+
+static void onSignal(int) {quitHost = true; stopScript = true;}
+
+// Checks the script file until it changed and stopped changing (the linker writes it in several steps)
+static void watchScript(ScriptHost* host)
+{
+    while (!quitHost)
+    {
+        this_thread::sleep_for(chrono::milliseconds(POLL_MS));
+        if (host->hasChanged()) stopScript = true;
+    }
+}
+
+static void waitUntilStable(ScriptHost& host)
+{
+    struct stat before, after;
+    do
+    {
+        if (::stat(host.getPath().c_str(), &before) != 0) before.st_size = -1;
+        this_thread::sleep_for(chrono::milliseconds(POLL_MS));
+        if (::stat(host.getPath().c_str(), &after)  != 0) after.st_size  = -1;
+    } while (!quitHost && (after.st_size <= 0 || before.st_size != after.st_size || before.st_mtime != after.st_mtime));
+}
+
+int main (int argc, char **argv)
+{
+    string xmlFile = "dtCommandsTMEV.xml";
+
+    // [--xml <file>] <script.so>, the rest goes to initComm() as for ./main
+    int first = 1;
+    if (argc > 2 && !strcmp(argv[1], "--xml")) {xmlFile = argv[2]; first = 3;}
+    if (argc - first < 2) {cout << "ERROR: No script or USB device file specified.\nTry something like this:\n./host scripts/example.so /dev/ttyUSB0\n"; return 1;}
+
+    ScriptHost script(argv[first]);
+    int    commArgc = argc - first;
+    char** commArgv = argv + first;     // script path stands in for argv[0]
+
+    if (!loadDocument(xmlFile, table))      return 1;
+    if (!initComm(commArgc, commArgv))      return 1;
+    initLogger();
+
+    signal(SIGINT,  onSignal);
+    signal(SIGTERM, onSignal);
+
+    thread watcher(watchScript, &script);
+
+    ScriptContext ctx;
+    ctx.apiVersion = SCRIPT_API_VERSION;
+    ctx.table      = &table;
+    ctx.stop       = &stopScript;
+    ctx.run        = 0;
+
+    while (!quitHost)
+    {
+        stopScript = false;
+        if (script.load())
+        {
+            ctx.run++;
+            cout << "Running '" << script.getPath() << "' (run " << ctx.run << ")\n";
+            int code = script.run(ctx);
+            cout << "Script returned " << code << '\n';
+            script.unload();
+        }
+        else cout << "ERROR: " << script.getError() << '\n';
+
+        // Wait for the next build (or ctrl+c)
+        if (!stopScript) cout << "Waiting for '" << script.getPath() << "' to change...\n";
+        while (!quitHost && !stopScript) this_thread::sleep_for(chrono::milliseconds(POLL_MS));
+        if (!quitHost) waitUntilStable(script);
+    }
+
+    watcher.join();
+    return 0;
+}
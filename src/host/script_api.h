@@ -0,0 +1,85 @@
+#ifndef SCRIPT_API_H
+#define SCRIPT_API_H
+
+/*
+ * API between the script host (`./host`) and scripts built as shared objects.
+ *
+ * A script includes this header and defines its entry point with BASECOMM_SCRIPT:
+ *
+ *      #include "../src/host/script_api.h"
+ *
+ *      BASECOMM_SCRIPT(ctx)
+ *      {
+ *          const Message* version = ctx.table->lookupMessage("Version_Command");
+ *          if (!version) return 1;
+ *
+ *          MessageInstance cmd(version);
+ *          MessageInstance rsp;
+ *          while (!ctx.shouldStop() && cmd.sendMessage(&rsp) == NONE)
+ *              ctx.wait(1000);
+ *          return 0;
+ *      }
+ *
+ * and is built with `make scripts/<name>.so`. The host keeps the port open, the
+ * table loaded and the logger running, and reloads the script whenever the .so
+ * changes. Triggers, change callbacks, retry policies and cached responses set
+ * up by a script are dropped when it is unloaded, set them up again on every run. Scripts call straight into the host's code (MessageInstance, table,
+ * logger...), so they must be built from the same tree: SCRIPT_API_VERSION is
+ * bumped whenever ScriptContext or those classes change layout, and the host
+ * refuses scripts built against another version.
+ */
+
+#include "../serial/lf_comm.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#define SCRIPT_API_VERSION  2
+
+// Same names as in main.cpp, so scripts move between both unchanged
+typedef uint8_t                 BITFIELD;
+typedef uint16_t                WORD;
+typedef std::string             STRING;
+typedef uint32_t                LONG_INT;
+typedef int16_t                 SIGNED_WORD;
+typedef const uint8_t*          BYTES;
+typedef std::vector<uint16_t>   WORDS;
+typedef uint64_t                LONG_LONG;
+typedef int8_t                  SIGNED_BYTE;
+
+struct ScriptContext
+{
+    int                         apiVersion;     // SCRIPT_API_VERSION of the host
+    const MessageTable*         table;          // loaded once by the host, shared by every run, read only.
+                                                // Look messages up with lookupMessage() (NULL if missing),
+                                                // findMessage() would exit the host
+    const std::atomic<bool>*    stop;           // set when the script file changed or the host exits
+    int                         run;            // 1 for the first load, incremented on every reload
+
+    // Long running scripts should check this in their loops and return when it is set
+    bool shouldStop() const { return stop->load(std::memory_order_relaxed); }
+
+    // Sleeps `ms` milliseconds unless a stop is requested first
+    // @return false if stopped
+    bool wait(int ms) const
+    {
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+        while (std::chrono::steady_clock::now() < end)
+        {
+            if (shouldStop()) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return !shouldStop();
+    }
+};
+
+typedef int (*ScriptVersionFn)();
+typedef int (*ScriptRunFn)(ScriptContext& ctx);
+
+// Defines the entry points the host looks up, followed by the body of the script
+#define BASECOMM_SCRIPT(ctx) \
+    extern "C" int basecommScriptVersion() { return SCRIPT_API_VERSION; } \
+    extern "C" int basecommScriptRun(ScriptContext& ctx)
+
+#endif // SCRIPT_API_H
@@ -0,0 +1,100 @@
+#include "script_host.h"
+
+#include <dlfcn.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool ScriptHost::stat(time_t& mtime, off_t& size) const
+{
+    struct stat info;
+    if (::stat(m_path.c_str(), &info) != 0) return false;
+
+    mtime = info.st_mtime;
+    size  = info.st_size;
+    return true;
+}
+
+bool ScriptHost::hasChanged() const
+{
+    time_t mtime;
+    off_t  size;
+    if (!stat(mtime, size)) return false;
+
+    std::lock_guard<std::mutex> lock(m_fileMutex);
+    return mtime != m_mtime || size != m_size;
+}
+
+bool ScriptHost::load()
+{
+    unload();
+    m_error.clear();
+
+    time_t mtime;
+    off_t  size;
+    if (!stat(mtime, size)) {m_error = "'" + m_path + "' not found"; return false;}
+    {
+        std::lock_guard<std::mutex> lock(m_fileMutex);
+        m_mtime = mtime;
+        m_size  = size;
+    }
+
+    // Private copy, removed as soon as it is mapped
+    std::string copy = "/tmp/basecomm_script_" + std::to_string(getpid()) + "_" + std::to_string(m_loads++) + ".so";
+    {
+        std::ifstream src(m_path, std::ios::binary);
+        std::ofstream dst(copy, std::ios::binary | std::ios::trunc);
+        dst << src.rdbuf();
+        if (!src || !dst) {m_error = "could not copy '" + m_path + "' to '" + copy + "'"; std::remove(copy.c_str()); return false;}
+    }
+
+    m_handle = dlopen(copy.c_str(), RTLD_NOW | RTLD_LOCAL);
+    std::remove(copy.c_str());
+    if (!m_handle) {m_error = dlerror(); return false;}
+
+    ScriptVersionFn version = reinterpret_cast<ScriptVersionFn>(dlsym(m_handle, "basecommScriptVersion"));
+    m_run                   = reinterpret_cast<ScriptRunFn>(dlsym(m_handle, "basecommScriptRun"));
+
+    if (!version || !m_run)
+    {
+        m_error = "no BASECOMM_SCRIPT entry point in '" + m_path + "'";
+        unload();
+        return false;
+    }
+    if (version() != SCRIPT_API_VERSION)
+    {
+        m_error = "'" + m_path + "' was built for script API " + std::to_string(version()) +
+                  ", host is " + std::to_string(SCRIPT_API_VERSION) + ", rebuild it";
+        unload();
+        return false;
+    }
+    return true;
+}
+
+// Engine state a script may have set up, reset before its code is unmapped: callbacks
+// (std::function) pointing into the .so would be called by the next exchange otherwise
+static void resetEngine()
+{
+    triggers.clear();
+    changeTracker.clearCallbacks();
+    changeTracker.reset();
+    changeTracker.enable(false);
+    commRetry.reset();
+    responseCache.reset();
+}
+
+void ScriptHost::unload()
+{
+    if (m_handle)
+    {
+        resetEngine();
+        dlclose(m_handle);
+    }
+    m_handle = nullptr;
+    m_run    = nullptr;
+}
+
+int ScriptHost::run(ScriptContext& ctx)
+{
+    return m_run ? m_run(ctx) : -1;
+}
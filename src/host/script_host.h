@@ -0,0 +1,59 @@
+#ifndef SCRIPT_HOST_H
+#define SCRIPT_HOST_H
+
+#include "script_api.h"
+
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+
+/**
+ * @brief The ScriptHost loads one script shared object and tells when it changed.
+ *
+ * The .so is copied to a private file before dlopen(), so the compiler can
+ * overwrite the original while it is loaded and every reload maps fresh code
+ * (dlopen() would otherwise hand back the cached library for the same path).
+ *
+ * unload() resets the engine state a script can register into (triggers, change
+ * callbacks, retry policies, cached responses) before dlclose(), so no callback
+ * is left pointing into unmapped code and every run starts from the defaults.
+ */
+class ScriptHost
+{
+    public:
+        explicit ScriptHost(const std::string& path) : m_path(path), m_handle(nullptr), m_run(nullptr), m_mtime(0), m_size(0), m_loads(0) {}
+        ~ScriptHost() { unload(); }
+
+        ScriptHost(const ScriptHost&)            = delete;
+        ScriptHost& operator=(const ScriptHost&) = delete;
+
+        // Unloads the current script (if any) and loads the file again
+        // @return false if it cannot be loaded or was built for another SCRIPT_API_VERSION, see getError()
+        bool load();
+        void unload();
+        bool isLoaded() const { return m_handle != nullptr; }
+
+        // Runs the loaded script on the calling thread, @return its return code
+        int  run(ScriptContext& ctx);
+
+        // True when the file on disk differs from the one last loaded (or tried), may be called from another thread
+        bool hasChanged() const;
+
+        const std::string& getPath()  const { return m_path;  }
+        const std::string& getError() const { return m_error; }
+        int                getLoads() const { return m_loads; }
+    private:
+        bool stat(time_t& mtime, off_t& size) const;
+
+        std::string     m_path;
+        std::string     m_error;
+        void*           m_handle;
+        ScriptRunFn     m_run;
+        time_t          m_mtime;    // of the file last loaded
+        off_t           m_size;
+        int             m_loads;
+
+        mutable std::mutex  m_fileMutex;    // m_mtime and m_size are read by hasChanged() on the watcher thread
+};
+
+#endif // SCRIPT_HOST_H
@@ -1,9 +1,24 @@
 #include "log.h"
+#include "log_rotator.h"
+#include "telemetry_store.h"
+#include "../parser/hex_codec.h"
+
+#include <ctime>
+#include <time.h>
 
 using namespace el;
 
 uint64_t initTime;
 
+static LogRotator logRotator;
+
+// Hands every formatted line to logRotator
+class RotatingFileCallback : public el::LogDispatchCallback
+{
+    protected:
+        void handle(const el::LogDispatchData* data) override { logRotator.write(data->logMessage()->message()); }
+};
+
 uint64_t timeSinceEpoch()
 {
     return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -11,11 +26,23 @@ uint64_t timeSinceEpoch()
     ).count());
 }
 
-std::string getPaddedTimestamp()
+uint64_t monotonicNanos()
 {
-    uint64_t timeDiff = timeSinceEpoch() - initTime;
-    
-    if (timeDiff >= MAX_TIMESTAMP)  initTime = timeSinceEpoch(); // reset the timestamps if need be
+#if defined(__linux__)
+    struct timespec tsp;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &tsp);
+    return uint64_t(tsp.tv_sec)*1000000000 + uint64_t(tsp.tv_nsec);
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count());
+#endif
+}
+
+std::string getPaddedTimestamp(uint64_t timestamp)
+{
+    // Wrap instead of resetting initTime, so intervals across the wrap stay correct
+    uint64_t timeDiff = ((timestamp - initTime) / 1000000) % (MAX_TIMESTAMP + 1);
 
     std::ostringstream oss;
     oss << std::setw(5) << std::setfill('0') << timeDiff;
@@ -23,20 +50,16 @@ std::string getPaddedTimestamp()
     return oss.str();
 }
 
-std::string bufferToString(uint8_t* buffer, uint8_t& size)
+std::string getPaddedTimestamp()
 {
-    std::ostringstream oss;
-
-    for (uint8_t i = 0; i < size; ++i) 
-    {
-        oss << std::uppercase
-            << std::setw(2)
-            << std::setfill('0')
-            << std::hex
-            << static_cast<int>(buffer[i]);
-    }
+    return getPaddedTimestamp(monotonicNanos());
+}
 
-    return oss.str();
+std::string bufferToString(uint8_t* buffer, uint8_t& size)
+{
+    std::string hex;
+    encodeHex(buffer, size, hex);
+    return hex;
 }
 
 void initLogger()
@@ -44,92 +67,88 @@ void initLogger()
     el::Configurations config;
     config.setToDefault();
 
-    // Redirect logger to terminal/file
-    if (LOG_TO_FILE) config.set(el::Level::Info, ConfigurationType::ToFile, "true");
-    else             config.set(el::Level::Info, ConfigurationType::ToFile, "false");
+    // Files are handled by logRotator, EasyLogging++ only formats and prints to terminal
+    config.set(el::Level::Info, ConfigurationType::ToFile, "false");
 
     if (LOG_TO_TERMINAL) config.set(Level::Info, ConfigurationType::ToStandardOutput, "true");
     else                 config.set(Level::Info, ConfigurationType::ToStandardOutput, "false");
 
-    // Logs directory
-    config.set(Level::Info, ConfigurationType::Filename, LOG_PATH);
-
-    // Max size of logs
-    int maxBytes = MAX_LOG_SIZE*1024*1024; // ([MiB] * 1024 [KiB/MiB]) * 1024 [bytes/KiB]
-    config.set(Level::Info, ConfigurationType::MaxLogFileSize, std::to_string(maxBytes));
-
-    // Flush three log lines max
-    el::Loggers::reconfigureAllLoggers(ConfigurationType::LogFlushThreshold, "3");
-
     // Format
     config.set(el::Level::Info, el::ConfigurationType::Format, "%msg");
     el::Loggers::reconfigureLogger("default", config);
 
-    // Rotating stuff
-    el::Loggers::addFlag(el::LoggingFlag::StrictLogFileSizeCheck);
-    el::Helpers::installPreRollOutCallback(PreRolloutCallback);
-
-    // Timestamp 
-    initTime = timeSinceEpoch();
-}
-
-void PreRolloutCallback(const char* fullPath, std::size_t s)
-{
-    std::string oldFilepath(fullPath);
-    std::string pathNoExtension = oldFilepath.substr(0, oldFilepath.find_last_of('.'));
-
-    static int version = MAX_LOGS-1;    // Older logs correspond to greater versions
-    
-    // Rotate case: max number of log files have been reached
-    if (version == 0)
+    // Rotating log files
+    if (LOG_TO_FILE)
     {
-        // Shift previous logs up one.
-        // example for SIZE=4
-        // .log -> .log.1, .log.1 -> .log.2 -> .log.3, .log.3 -> SHIFTED OUT/OVERWRITTEN
-        for (int i = MAX_LOGS-1; i >= 0; i--)
-        {
-            std::string oldName = pathNoExtension + ".log." + std::to_string(i);
-            std::string newName = pathNoExtension + ".log." + std::to_string(i+1);
-
-            // Delete file case
-            if (i == MAX_LOGS-1) {remove(oldName.c_str()); continue;}
+        char path[256];
+        std::time_t now = std::time(nullptr);
+        std::strftime(path, sizeof(path), LOG_PATH, std::localtime(&now));
 
-            // .log -> .log.1 case
-            if (i == 0)
-            {
-                oldName = pathNoExtension + ".log";
-                rename(oldName.c_str(), newName.c_str());
-                return;
-            }
-
-            rename(oldName.c_str(), newName.c_str());
-        }
+        size_t maxBytes = size_t(MAX_LOG_SIZE)*1024*1024; // ([MiB] * 1024 [KiB/MiB]) * 1024 [bytes/KiB]
+        if (logRotator.open(path, maxBytes, std::chrono::minutes(MAX_LOG_TIME), MAX_LOGS, LOG_FLUSH_LINES))
+            el::Helpers::installLogDispatchCallback<RotatingFileCallback>("RotatingFile");
     }
 
-    std::string newFilePath = pathNoExtension + ".log." + std::to_string(version);
-    version--;
-    rename(fullPath, newFilePath.c_str());
+    // Compressed report history
+    if (LOG_TELEMETRY && telemetryStore.open(TELEMETRY_PATH)) TelemetryWriter::closeOnSignal();
+
+    // Timestamp 
+    initTime = monotonicNanos();
 }
 
-void logMessage(comm_error status, DIRECTION dir,  uint8_t* buffer, uint8_t& size)
+void logMessage(comm_error status, DIRECTION dir,  uint8_t* buffer, uint8_t& size, uint64_t timestamp)
 {
+    static thread_local std::string hex;   // reused from line to line
+
     if (status != NONE)
     {
         switch (status)
         {
             case BAD_CHECKSUM:
-                LOG(INFO) << getPaddedTimestamp() << "ms " << "ERROR_BAD_CHECKSUM" << " 0x" << bufferToString(buffer, size);
+                encodeHex(buffer, size, hex);
+                LOG(INFO) << getPaddedTimestamp(timestamp) << "ms " << "ERROR_BAD_CHECKSUM" << " 0x" << hex;
                 break;
             case TIMEOUT:
-                LOG(INFO) << getPaddedTimestamp() << "ms " << "ERROR_TIMEOUT";
+                LOG(INFO) << getPaddedTimestamp(timestamp) << "ms " << "ERROR_TIMEOUT";
                 break;
             case EMPTY_READ:
-                LOG(INFO) << getPaddedTimestamp() << "ms " << "ERROR_MISSING_PACKET";
+                LOG(INFO) << getPaddedTimestamp(timestamp) << "ms " << "ERROR_MISSING_PACKET";
+                break;
+            case BAD_FRAME:
+                encodeHex(buffer, size, hex);
+                LOG(INFO) << getPaddedTimestamp(timestamp) << "ms " << "ERROR_BAD_FRAME" << " 0x" << hex;
+                break;
+            case INVALID_MSG:
+                encodeHex(buffer, size, hex);
+                LOG(INFO) << getPaddedTimestamp(timestamp) << "ms " << "ERROR_INVALID_MSG" << " 0x" << hex;
+                break;
+            case IO_ERROR:
+                LOG(INFO) << getPaddedTimestamp(timestamp) << "ms " << "ERROR_IO";
+                break;
+            case FIFO_OVERRUN:
+                LOG(INFO) << getPaddedTimestamp(timestamp) << "ms " << "ERROR_FIFO_OVERRUN";
+                break;
+            case FRAMING_ERROR:
+                LOG(INFO) << getPaddedTimestamp(timestamp) << "ms " << "ERROR_FRAMING";
+                break;
+            case PARITY_ERROR:
+                encodeHex(buffer, size, hex);
+                LOG(INFO) << getPaddedTimestamp(timestamp) << "ms " << "ERROR_PARITY" << " 0x" << hex;
+                break;
+            case DATA_PRESENT_BEFORE_NEXT_PACKET:
+                encodeHex(buffer, size, hex);
+                LOG(INFO) << getPaddedTimestamp(timestamp) << "ms " << "ERROR_DATA_PRESENT_BEFORE_NEXT_PACKET" << " 0x" << hex;
+                break;
+            case PINSWAP_TIMEOUT:
+                LOG(INFO) << getPaddedTimestamp(timestamp) << "ms " << "ERROR_PINSWAP_TIMEOUT";
+                break;
+            default:
                 break;
         }
         return;
     }
 
     std::string inOut = (dir == Out) ? "OUT":"IN "; 
-    LOG(INFO) << getPaddedTimestamp() << "ms " << inOut << " 0x" << bufferToString(buffer, size);
+    encodeHex(buffer, size, hex);
+    LOG(INFO) << getPaddedTimestamp(timestamp) << "ms " << inOut << " 0x" << hex;
 } 
\ No newline at end of file
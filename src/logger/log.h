@@ -3,17 +3,20 @@
 
 #define LOG_TO_TERMINAL  false                                      // prints logs to terminal if true
 #define LOG_TO_FILE      true                    
-#define LOG_PATH         "logs/data.%datetime{%M%d_%H%m%s}.log"     // relative to the executable file
+#define LOG_PATH         "logs/data.%m%d_%H%M%S"                   // relative to the executable file, strftime format, ".log" is appended
 #define MAX_LOGS         6                                          // maximum log files before logger starts overwriting
 #define MAX_LOG_SIZE     4                                          // in MiB (basically MB)
-#define MAX_LOG_TIME     180                                        // in minutes; time to manually rotate logs (unimplemented)
+#define MAX_LOG_TIME     180                                        // in minutes; rotates the log even if not full (0 to disable)
+#define LOG_FLUSH_LINES  3                                          // lines buffered before they are written out
+#define LOG_TELEMETRY    false                                      // also stores received reports compressed (see telemetry_store.h)
+#define TELEMETRY_PATH   "logs/telemetry.bcts"                      // relative to the executable file, appended to across runs
 
 #include "../lib/easylogging/easylogging++.h"
 
 #include <chrono>
 #include <iomanip>
 #include "../serial/comm_errors.h"
-#define MAX_TIMESTAMP   uint64_t(99999)
+#define MAX_TIMESTAMP   uint64_t(99999)     // Sniffer timestamps wrap around after this (ms)
 
 enum DIRECTION
 {
@@ -21,13 +24,18 @@ enum DIRECTION
     In
 };
 
-extern uint64_t initTime;   // time since epoch of the when program began
+extern uint64_t initTime;   // monotonicNanos() of when the program began
 
-uint64_t timeSinceEpoch();  // in ms
+uint64_t timeSinceEpoch();  // in ms, wall clock (may jump with NTP)
 
-// Time difference between current and program init
-// formmatted as a zero-padded 5 digit number
-std::string getPaddedTimestamp();
+// CLOCK_MONOTONIC_RAW in ns (steady_clock on Windows), never adjusted by NTP.
+// Packet timestamps are taken with this right after the read()/write() call.
+uint64_t monotonicNanos();
+
+// Time difference between `timestamp` (from monotonicNanos()) and program init in ms,
+// formmatted as a zero-padded 5 digit number that wraps around after 99999
+std::string getPaddedTimestamp(uint64_t timestamp);
+std::string getPaddedTimestamp();   // now
 
 // Takes in a buffer (typically outBuffer or inBuffer) as well as the size 
 // to return a printable hex string
@@ -36,13 +44,10 @@ std::string bufferToString(uint8_t* buffer, uint8_t& size);
 /*
  * Uses the defined macros to setup a rotating logger.
  * Changes the formatting of EasyLogging++ to conform to Sniffer clicker standards
+ * Log files are written and rotated by a LogRotator (see log_rotator.h), off the serial thread.
  */
 void initLogger();
 
-// Executes when the top-most (or most recent) .log file gets full.
-// Log rotation logic implemented here
-void PreRolloutCallback(const char* fullPath, std::size_t size);
-
 /*
  * Takes in information about a message (or error) and logs it universally
  * The format of Sniffer logs is explained below:
@@ -51,8 +56,9 @@ void PreRolloutCallback(const char* fullPath, std::size_t size);
  *          OR
  * SSSSSms OUT 0x<DATA_BUFFER>
  * 
- * SSSSS is the zero-padded timestamp (in ms) which rolls over when it reaches 99999
+ * SSSSS is the zero-padded timestamp (in ms) which rolls over when it reaches 99999,
+ * derived from `timestamp` (monotonicNanos() taken when the packet went through the port)
  */
-void logMessage(comm_error status, DIRECTION dir,  uint8_t* buffer, uint8_t& size);
+void logMessage(comm_error status, DIRECTION dir,  uint8_t* buffer, uint8_t& size, uint64_t timestamp);
 
 #endif // LOG_H
\ No newline at end of file
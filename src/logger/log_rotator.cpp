@@ -0,0 +1,141 @@
+#include "log_rotator.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+bool LogRotator::open(const std::string& base, size_t maxBytes, std::chrono::minutes maxAge, int maxFiles, int flushLines)
+{
+    close();
+
+    m_base       = base;
+    m_maxBytes   = maxBytes;
+    m_maxAge     = maxAge;
+    m_maxFiles   = maxFiles;
+    m_flushLines = std::max(flushLines, 1);
+
+    std::error_code ec;
+    std::filesystem::path parent = std::filesystem::path(base).parent_path();
+    if (!parent.empty()) std::filesystem::create_directories(parent, ec);
+
+    m_active  = 0;
+    m_opened  = 0;
+    m_current = std::fopen(fileName(0).c_str(), "w");
+    if (!m_current) {std::cout << "ERROR: Log file '" << base << ".log' could not be created...\n"; return false;}
+
+    m_written   = 0;
+    m_unflushed = 0;
+    m_openedAt  = std::chrono::steady_clock::now();
+    m_stop      = false;
+
+    // The first next file is prepared by the background thread like every other one
+    m_thread = std::thread(&LogRotator::backgroundLoop, this);
+    return true;
+}
+
+void LogRotator::close()
+{
+    if (m_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+    }
+
+    // Rotation handed over right before closing
+    if (m_retired)
+    {
+        retire(m_retired);
+        m_retired = nullptr;
+    }
+
+    if (m_current) {std::fclose(m_current); m_current = nullptr;}
+    if (m_next)
+    {
+        std::fclose(m_next);
+        m_next = nullptr;
+        std::remove(fileName(m_opened).c_str());    // preopened, never written
+    }
+}
+
+void LogRotator::write(const std::string& line)
+{
+    if (!m_current) return;
+
+    std::fwrite(line.data(), 1, line.size(), m_current);
+    std::fputc('\n', m_current);
+    m_written += line.size() + 1;
+
+    if (++m_unflushed >= m_flushLines) {std::fflush(m_current); m_unflushed = 0;}
+
+    bool full    = m_maxBytes && m_written >= m_maxBytes;
+    bool expired = m_maxAge.count() && std::chrono::steady_clock::now() - m_openedAt >= m_maxAge;
+    if (!full && !expired) return;
+
+    // Swap to the preopened file, never wait for it
+    {
+        std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+        if (!lock.owns_lock() || !m_next || m_retired) return;
+
+        m_retired = m_current;
+        m_current = m_next;
+        m_next    = nullptr;
+    }
+    m_wake.notify_one();
+
+    m_written   = 0;
+    m_unflushed = 0;
+    m_openedAt  = std::chrono::steady_clock::now();
+    m_rotations++;
+}
+
+void LogRotator::backgroundLoop()
+{
+    bool canOpen = true;
+
+    while (true)
+    {
+        FILE* retired;
+        bool needNext;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || m_retired || (!m_next && canOpen); });
+
+            if (m_stop) return;
+            retired  = m_retired;
+            needNext = !m_next && canOpen;
+        }
+
+        // Filesystem work happens here, outside the lock
+        if (retired) retire(retired);
+
+        FILE* next = nullptr;
+        if (needNext)
+        {
+            std::string nextName = fileName(m_opened + 1);
+            next = std::fopen(nextName.c_str(), "w");
+            if (next) m_opened++;
+            else {std::cout << "ERROR: Log file '" << nextName << "' could not be created, rotation stopped...\n"; canOpen = false;}
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (retired) m_retired = nullptr;
+        if (next) m_next = next;
+    }
+}
+
+void LogRotator::retire(FILE* file)
+{
+    // The writer moved on to the preopened file, the oldest one past m_maxFiles goes
+    std::fclose(file);
+    m_active++;
+    if (m_active >= m_maxFiles) std::remove(fileName(m_active - m_maxFiles).c_str());
+}
+
+std::string LogRotator::fileName(int index) const
+{
+    return index ? m_base + "." + std::to_string(index) + ".log" : m_base + ".log";
+}
@@ -0,0 +1,76 @@
+#ifndef LOG_ROTATOR_H
+#define LOG_ROTATOR_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * @brief The LogRotator owns the log files and rotates them without ever
+ * blocking the thread that logs.
+ *
+ * Lines are appended to the active file and its size is counted as they are
+ * written, no file size check is made per line. Once the file reaches
+ * `maxBytes` or gets older than `maxAge`, the writer swaps to the next file
+ * (already opened by the background thread) under a short lock and hands the
+ * full one over. The background thread then closes it, deletes the oldest file
+ * past `maxFiles` and opens the next one. If that is not ready yet the writer
+ * keeps appending to the current file and tries again on the next line.
+ *
+ * Files are opened under their final name and never renamed (Windows can't
+ * rename a file that is open): `<base>.log` first, then `<base>.1.log`,
+ * `<base>.2.log`... The next file is created empty ahead of its turn.
+ */
+class LogRotator
+{
+    public:
+        LogRotator() {}
+        ~LogRotator() { close(); }
+
+        LogRotator(const LogRotator&)            = delete;
+        LogRotator& operator=(const LogRotator&) = delete;
+
+        // Opens `<base>.log` and starts the background thread, `maxAge` of zero disables time based rotation
+        // @return false if the file cannot be created
+        bool open(const std::string& base, size_t maxBytes, std::chrono::minutes maxAge, int maxFiles, int flushLines);
+        void close();       // waits for pending rotations, then closes every file
+
+        // Appends `line` and a newline, rotates if needed. Called by one thread at a time.
+        void write(const std::string& line);
+
+        int  getRotations() const { return m_rotations; }
+    private:
+        void backgroundLoop();
+        void retire(FILE* file);                    // closes a full file, deletes the one past m_maxFiles
+        std::string fileName(int index) const;      // `<base>.log`, then `<base>.<index>.log`
+
+        std::string                             m_base;
+        size_t                                  m_maxBytes   = 0;
+        std::chrono::minutes                    m_maxAge{0};
+        int                                     m_maxFiles   = 0;
+        int                                     m_flushLines = 1;
+
+        // Writer side
+        FILE*                                   m_current    = nullptr;
+        size_t                                  m_written    = 0;
+        int                                     m_unflushed  = 0;
+        std::chrono::steady_clock::time_point   m_openedAt;
+        int                                     m_rotations  = 0;
+
+        // Shared with the background thread, guarded by m_mutex
+        std::mutex                              m_mutex;
+        std::condition_variable                 m_wake;
+        FILE*                                   m_next       = nullptr;    // preopened, NULL while being prepared
+        FILE*                                   m_retired    = nullptr;    // full file to close
+        bool                                    m_stop       = false;
+        std::thread                             m_thread;
+
+        // Background thread (and close() once it is stopped)
+        int                                     m_active     = 0;          // index of the file being written
+        int                                     m_opened     = 0;          // index of the last file opened
+};
+
+#endif // LOG_ROTATOR_H
@@ -0,0 +1,357 @@
+#include "telemetry_store.h"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+
+TelemetryWriter telemetryStore;
+
+// Set by the SIGINT/SIGTERM handler of closeOnSignal(), the only thing it does (lock free, so signal safe)
+static std::atomic<int> terminateSignal(0);
+
+static const char   TELEMETRY_MAGIC[4]  = {'B', 'C', 'T', 'S'};
+static const BYTE   TELEMETRY_VERSION   = 1;
+static const size_t MAX_TAG_LEN         = 64;    // search tags are "TT:SS:MM[:LL]", anything longer is garbage
+
+/* Encoding helpers */
+
+static void putVarint(std::vector<BYTE>& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(BYTE(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(BYTE(value));
+}
+
+static bool getVarint(std::istream& in, uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        int c = in.get();
+        if (c == EOF) return false;
+
+        value |= uint64_t(c & 0x7F) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+static uint64_t zigzag(uint64_t delta)   { return (delta << 1) ^ uint64_t(int64_t(delta) >> 63); }
+static uint64_t unzigzag(uint64_t value) { return (value >> 1) ^ (~(value & 1) + 1); }
+
+// Delta + run-length encodes `count` values read through `valueAt`
+template <typename F>
+static void putColumn(std::vector<BYTE>& out, size_t count, F valueAt)
+{
+    uint64_t previous = 0, runDelta = 0, runLength = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t value = valueAt(i);
+        uint64_t delta = value - previous;
+        previous = value;
+
+        if (runLength && delta == runDelta) {runLength++; continue;}
+        if (runLength) {putVarint(out, runLength); putVarint(out, zigzag(runDelta));}
+
+        runDelta  = delta;
+        runLength = 1;
+    }
+    if (runLength) {putVarint(out, runLength); putVarint(out, zigzag(runDelta));}
+}
+
+// Inverse of putColumn(), hands every value to `store`
+template <typename F>
+static bool getColumn(std::istream& in, size_t count, F store)
+{
+    uint64_t previous = 0;
+
+    for (size_t i = 0; i < count; )
+    {
+        uint64_t runLength, delta;
+        if (!getVarint(in, runLength) || !getVarint(in, delta) || runLength == 0 || runLength > count - i) return false;
+
+        delta = unzigzag(delta);
+        for (; runLength; runLength--, i++)
+        {
+            previous += delta;
+            store(i, previous);
+        }
+    }
+    return true;
+}
+
+// Field boundaries split in chunks of at most 8 bytes, so every column fits a uint64_t
+static std::vector<BYTE> columnWidths(const Message* schema)
+{
+    int size = schema->getDataSize();
+    std::vector<bool> boundary(size + 1, false);
+    for (const MessageField& field : schema->getDataFormat())
+        if (field.getOffset() < size) boundary[field.getOffset()] = true;
+
+    std::vector<BYTE> widths;
+    for (int start = 0; start < size; )
+    {
+        int end = start + 1;
+        while (end < size && !boundary[end] && end - start < 8) end++;
+
+        widths.push_back(BYTE(end - start));
+        start = end;
+    }
+    return widths;
+}
+
+/* TelemetryWriter */
+
+bool TelemetryWriter::open(const std::string& path)
+{
+    close();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_file.open(path, std::ios::binary | std::ios::app);
+    if (!m_file.is_open()) {std::cout << "ERROR: Telemetry file '" << path << "' could not be opened...\n"; return false;}
+
+    // New file: write the magic first
+    if (m_file.tellp() == 0)
+    {
+        m_file.write(TELEMETRY_MAGIC, sizeof(TELEMETRY_MAGIC));
+        m_file.put(char(TELEMETRY_VERSION));
+    }
+
+    m_stop   = false;
+    m_thread = std::thread(&TelemetryWriter::writerLoop, this);
+    return true;
+}
+
+void TelemetryWriter::close()
+{
+    if (m_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.is_open()) return;
+
+    writePending();
+    m_file.close();
+    m_pending.clear();
+}
+
+static void onTerminate(int signal)
+{
+    terminateSignal = signal;
+}
+
+void TelemetryWriter::closeOnSignal()
+{
+    std::signal(SIGINT,  onTerminate);
+    std::signal(SIGTERM, onTerminate);
+}
+
+void TelemetryWriter::writerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stop)
+    {
+        m_wake.wait_for(lock, std::chrono::milliseconds(TELEMETRY_POLL_MS));
+
+        int signal = terminateSignal;
+        if (!signal)
+        {
+            // Reports of a message that stopped reporting (or of every message, when nothing is received anymore)
+            bool pending = m_oldestAt != std::chrono::steady_clock::time_point();
+            if (pending && std::chrono::steady_clock::now() - m_oldestAt >= std::chrono::milliseconds(TELEMETRY_FLUSH_MS)) writePending();
+            continue;
+        }
+
+        // Out of the handler: safe to write, then end the program as the signal would have
+        writePending();
+        m_file.close();
+        m_pending.clear();
+        lock.unlock();
+
+        std::signal(signal, SIG_DFL);
+        std::raise(signal);
+        return;
+    }
+}
+
+void TelemetryWriter::record(const MessageInstance& report, uint64_t timestamp)
+{
+    const Message* schema = report.getSchema();
+    if (!schema) return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.is_open()) return;
+
+    Pending& pending = m_pending[schema];
+    if (pending.timestamps.empty())
+    {
+        pending.timestamps.reserve(TELEMETRY_BLOCK_RECORDS);
+        pending.data.reserve(size_t(TELEMETRY_BLOCK_RECORDS) * schema->getDataSize());
+    }
+
+    pending.timestamps.push_back(timestamp);
+    pending.data.insert(pending.data.end(), report.getData(), report.getData() + schema->getDataSize());
+
+    if (pending.timestamps.size() >= TELEMETRY_BLOCK_RECORDS) writeBlock(schema, pending);
+
+    if (m_oldestAt == std::chrono::steady_clock::time_point()) m_oldestAt = std::chrono::steady_clock::now();
+}
+
+void TelemetryWriter::flush()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    writePending();
+}
+
+void TelemetryWriter::writePending()
+{
+    if (!m_file.is_open()) return;
+
+    for (std::pair<const Message* const, Pending>& pending : m_pending)
+        if (!pending.second.timestamps.empty()) writeBlock(pending.first, pending.second);
+
+    m_file.flush();
+    m_oldestAt = std::chrono::steady_clock::time_point();
+}
+
+void TelemetryWriter::writeBlock(const Message* schema, Pending& pending)
+{
+    std::string_view tag = schema->getSearchTag();
+    int dataSize = schema->getDataSize();
+    size_t count = pending.timestamps.size();
+    std::vector<BYTE> widths = columnWidths(schema);
+
+    m_block.clear();
+    putVarint(m_block, tag.size());
+    m_block.insert(m_block.end(), tag.begin(), tag.end());
+    m_block.insert(m_block.end(), schema->getHeader(), schema->getHeader() + HEADER_LEN);
+    putVarint(m_block, dataSize);
+    putVarint(m_block, widths.size());
+    m_block.insert(m_block.end(), widths.begin(), widths.end());
+    putVarint(m_block, count);
+
+    putColumn(m_block, count, [&](size_t i) { return pending.timestamps[i]; });
+
+    const BYTE* data = pending.data.data();
+    int offset = 0;
+    for (BYTE width : widths)
+    {
+        putColumn(m_block, count, [&](size_t i) { return loadBigEndian(data + i*dataSize + offset, width); });
+        offset += width;
+    }
+
+    m_file.write(reinterpret_cast<const char*>(m_block.data()), m_block.size());
+    m_bytesWritten += m_block.size();
+
+    pending.timestamps.clear();
+    pending.data.clear();
+}
+
+/* TelemetryReader */
+
+bool TelemetryReader::open(const std::string& path)
+{
+    m_file.open(path, std::ios::binary);
+    m_records.clear();
+    m_position = 0;
+
+    char magic[sizeof(TELEMETRY_MAGIC) + 1];
+    if (!m_file.is_open() || !m_file.read(magic, sizeof(magic))
+        || !std::equal(TELEMETRY_MAGIC, TELEMETRY_MAGIC + sizeof(TELEMETRY_MAGIC), magic) || BYTE(magic[4]) != TELEMETRY_VERSION)
+    {
+        std::cout << "ERROR: '" << path << "' is not a telemetry file...\n";
+        m_file.close();
+        return false;
+    }
+    return true;
+}
+
+bool TelemetryReader::next(TelemetryRecord& out)
+{
+    while (m_position >= m_records.size())
+        if (!readBlock()) return false;
+
+    out = m_records[m_position++];
+    return true;
+}
+
+bool TelemetryReader::readBlock()
+{
+    m_records.clear();
+    m_position = 0;
+
+    uint64_t tagLen;
+    if (!m_file.is_open() || !getVarint(m_file, tagLen)) return false;     // end of file
+    if (tagLen > MAX_TAG_LEN) {std::cout << "ERROR: Corrupted telemetry block...\n"; return false;}
+
+    std::string tag(tagLen, '\0');
+    BYTE header[HEADER_LEN];
+    uint64_t dataSize, columnCount, count;
+
+    if (!m_file.read(&tag[0], tagLen) || !m_file.read(reinterpret_cast<char*>(header), HEADER_LEN)
+        || !getVarint(m_file, dataSize) || dataSize > MAX_DATA_LEN || !getVarint(m_file, columnCount) || columnCount > dataSize)
+    {
+        std::cout << "ERROR: Corrupted telemetry block...\n";
+        return false;
+    }
+
+    std::vector<BYTE> widths(columnCount);
+    // The writer never puts more than TELEMETRY_BLOCK_RECORDS reports in a block, a bigger count is garbage
+    if (!m_file.read(reinterpret_cast<char*>(widths.data()), columnCount) || !getVarint(m_file, count)
+        || count == 0 || count > TELEMETRY_BLOCK_RECORDS)
+    {
+        std::cout << "ERROR: Corrupted telemetry block...\n";
+        return false;
+    }
+
+    // Rebuild the packets: header, data, checksum
+    m_records.resize(count);
+    for (TelemetryRecord& record : m_records)
+    {
+        record.searchTag = tag;
+        record.packet.assign(HEADER_LEN + dataSize + 1, 0);
+        std::copy(header, header + HEADER_LEN, record.packet.begin());
+    }
+
+    bool ok = getColumn(m_file, count, [&](size_t i, uint64_t value) { m_records[i].timestamp = value; });
+
+    int offset = HEADER_LEN;
+    for (size_t c = 0; ok && c < columnCount; c++)
+    {
+        int width = widths[c];
+        if (width < 1 || width > 8 || offset + width > int(HEADER_LEN + dataSize)) {ok = false; break;}
+
+        ok = getColumn(m_file, count, [&](size_t i, uint64_t value)
+        {
+            for (int b = width - 1; b >= 0; b--, value >>= 8)
+                m_records[i].packet[offset + b] = BYTE(value);
+        });
+        offset += width;
+    }
+
+    if (!ok)
+    {
+        std::cout << "ERROR: Corrupted telemetry block...\n";
+        m_records.clear();
+        return false;
+    }
+
+    for (TelemetryRecord& record : m_records)
+    {
+        BYTE checksum = 0;
+        for (size_t i = 0; i + 1 < record.packet.size(); i++) checksum += record.packet[i];
+        record.packet.back() = -1*checksum;
+    }
+    return true;
+}
@@ -0,0 +1,129 @@
+#ifndef TELEMETRY_STORE_H
+#define TELEMETRY_STORE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../parser/msg_instance.h"
+
+#define TELEMETRY_BLOCK_RECORDS  1024   // reports of one message buffered before a block is written
+#define TELEMETRY_FLUSH_MS       60000  // buffered reports are written at most this long after they came in (ms), by the writer thread
+#define TELEMETRY_POLL_MS        100    // how often the writer thread checks for a termination signal and old reports
+
+/*
+ * Long term storage of received reports, meant for endurance runs where the
+ * hex logs would rotate history away (see MAX_LOGS).
+ *
+ * Reports are buffered per message and written in blocks. A block holds the
+ * message's search tag and header bytes once, then one column per field (fields
+ * wider than 8 bytes are split in 8 byte columns) plus a timestamp column. Each
+ * column stores the difference with the previous value, and repeated differences
+ * are run-length encoded, so a field that never changes costs a few bytes per
+ * block and a counter incrementing by one costs the same.
+ *
+ * File layout (all numbers are LEB128 varints unless noted):
+ *
+ * "BCTS" <version byte>
+ * block: <tag length> <tag> <5 header bytes> <data size> <column count> <column widths (bytes)>
+ *        <record count> <timestamp column> <data columns...>
+ * column: (<run length> <zigzag delta>)... until record count values
+ *
+ * Blocks are independent, so a file can be appended to across runs. A message
+ * that rarely reports gets short blocks: buffered reports are written at most
+ * TELEMETRY_FLUSH_MS after the oldest of them came in, and on SIGINT/SIGTERM
+ * the writer is closed before the program ends (see closeOnSignal()).
+ */
+
+// One report read back from a telemetry file
+struct TelemetryRecord
+{
+    std::string         searchTag;
+    uint64_t            timestamp;  // ms since epoch
+    std::vector<BYTE>   packet;     // header, data bytes and checksum, as received
+};
+
+/**
+ * @brief The TelemetryWriter buffers reports and writes them in blocks.
+ *
+ * open() starts a background thread that writes reports pending for longer than
+ * TELEMETRY_FLUSH_MS, even when no report comes in anymore, and polls for a
+ * termination signal (see closeOnSignal()), the signal handler itself only sets a flag. record() may be
+ * called from any thread, one at a time with the writer thread (m_mutex).
+ */
+class TelemetryWriter
+{
+    public:
+        TelemetryWriter() {}
+        ~TelemetryWriter() { close(); }
+
+        TelemetryWriter(const TelemetryWriter&)            = delete;
+        TelemetryWriter& operator=(const TelemetryWriter&) = delete;
+
+        // Appends to `path` (created if missing) and starts the writer thread
+        // @return false if the file cannot be opened
+        bool open(const std::string& path);
+        void close();           // stops the writer thread, flushes and closes
+        bool isOpen() const     { return m_file.is_open(); }
+
+        // Buffers a report, a block is written once its message reaches TELEMETRY_BLOCK_RECORDS,
+        // and the writer thread writes every pending block once the oldest is TELEMETRY_FLUSH_MS old
+        void record(const MessageInstance& report, uint64_t timestamp);
+
+        // Writes every buffered report
+        void flush();
+
+        // On SIGINT/SIGTERM the writer thread closes telemetryStore, then ends the program as the
+        // signal would have. Programs with their own handlers (./host, ./sequencer) return from main()
+        // and close it there
+        static void closeOnSignal();
+
+        uint64_t getBytesWritten() const { return m_bytesWritten; }
+    private:
+        struct Pending
+        {
+            std::vector<uint64_t>   timestamps;
+            std::vector<BYTE>       data;       // data bytes of every report, back to back
+        };
+
+        void writerLoop();
+        void writePending();    // m_mutex held
+        void writeBlock(const Message* schema, Pending& pending);
+
+        std::ofstream                                   m_file;
+        std::unordered_map<const Message*, Pending>     m_pending;
+        std::vector<BYTE>                               m_block;   // encode buffer, reused
+        uint64_t                                        m_bytesWritten = 0;
+        std::chrono::steady_clock::time_point           m_oldestAt;     // when the first report since the last flush came in
+
+        std::mutex                                      m_mutex;    // everything above, between record() and the writer thread
+        std::condition_variable                         m_wake;
+        bool                                            m_stop         = false;
+        std::thread                                     m_thread;
+};
+
+class TelemetryReader
+{
+    public:
+        // @return false if `path` cannot be opened or is not a telemetry file
+        bool open(const std::string& path);
+
+        // Reads the next report in file order (blocks of different messages are interleaved)
+        // @return false at the end of the file or on a corrupted block
+        bool next(TelemetryRecord& out);
+    private:
+        bool readBlock();
+
+        std::ifstream                   m_file;
+        std::vector<TelemetryRecord>    m_records;     // decoded block
+        size_t                          m_position = 0;
+};
+
+extern TelemetryWriter telemetryStore;
+
+#endif // TELEMETRY_STORE_H
@@ -0,0 +1,47 @@
+#include "byte_order.h"
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+#endif
+
+// Swaps the two bytes of every word from `src` into `dst`: same operation for both directions
+static void swapWords(const BYTE* src, BYTE* dst, size_t count)
+{
+#if HOST_IS_BIG_ENDIAN
+    std::memcpy(dst, src, count * 2);
+#else
+    size_t i = 0;
+
+    #if defined(__SSE2__)
+    // 8 words per iteration: (w << 8) | (w >> 8) on each 16-bit lane
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i*2));
+        words = _mm_or_si128(_mm_slli_epi16(words, 8), _mm_srli_epi16(words, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i*2), words);
+    }
+    #elif defined(__ARM_NEON)
+    for (; i + 8 <= count; i += 8)
+        vst1q_u8(dst + i*2, vrev16q_u8(vld1q_u8(src + i*2)));
+    #endif
+
+    // Leftover words
+    for (; i < count; i++)
+    {
+        dst[i*2]     = src[i*2 + 1];
+        dst[i*2 + 1] = src[i*2];
+    }
+#endif
+}
+
+void decodeWords(const BYTE* src, uint16_t* dst, size_t count)
+{
+    swapWords(src, reinterpret_cast<BYTE*>(dst), count);
+}
+
+void encodeWords(const uint16_t* src, BYTE* dst, size_t count)
+{
+    swapWords(reinterpret_cast<const BYTE*>(src), dst, count);
+}
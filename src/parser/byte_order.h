@@ -0,0 +1,59 @@
+#ifndef BYTE_ORDER_H
+#define BYTE_ORDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+typedef uint8_t BYTE;
+
+/*
+ * Packets are big endian (MSB closest to the header). These helpers convert
+ * between packet bytes and host integers without building temporary vectors.
+ */
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    #define HOST_IS_BIG_ENDIAN 1
+#else
+    #define HOST_IS_BIG_ENDIAN 0
+#endif
+
+inline uint16_t byteSwap(uint16_t value) { return __builtin_bswap16(value); }
+inline uint32_t byteSwap(uint32_t value) { return __builtin_bswap32(value); }
+inline uint64_t byteSwap(uint64_t value) { return __builtin_bswap64(value); }
+
+// Reads a big endian unsigned integer of exactly sizeof(T) bytes
+template <typename T>
+inline T loadBigEndian(const BYTE* src)
+{
+    T value;
+    std::memcpy(&value, src, sizeof(T));
+    return HOST_IS_BIG_ENDIAN ? value : byteSwap(value);
+}
+
+// Writes `value` as a big endian unsigned integer of exactly sizeof(T) bytes
+template <typename T>
+inline void storeBigEndian(T value, BYTE* dst)
+{
+    if (!HOST_IS_BIG_ENDIAN) value = byteSwap(value);
+    std::memcpy(dst, &value, sizeof(T));
+}
+
+// Reads a big endian integer of any `size`, bytes that don't fit in 64 bits are dropped from the top
+inline uint64_t loadBigEndian(const BYTE* src, int size)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < size; i++)
+        value = (value << 8) | src[i];
+    return value;
+}
+
+/*
+ * Bulk conversion of `count` 16-bit words (the `words` field type).
+ * Uses SSE2/NEON 16 bytes at a time when the target has them, a bswap loop otherwise.
+ * `src` and `dst` may be unaligned but must not overlap.
+ */
+void decodeWords(const BYTE* src, uint16_t* dst, size_t count);     // packet -> host
+void encodeWords(const uint16_t* src, BYTE* dst, size_t count);     // host -> packet
+
+#endif // BYTE_ORDER_H
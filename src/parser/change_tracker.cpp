@@ -0,0 +1,104 @@
+#include "change_tracker.h"
+
+ChangeTracker changeTracker;
+
+bool FieldBitmap::any() const
+{
+    for (uint64_t word : words)
+        if (word) return true;
+    return false;
+}
+
+int FieldBitmap::count() const
+{
+    int total = 0;
+    for (uint64_t word : words)
+        total += __builtin_popcountll(word);
+    return total;
+}
+
+FieldBitmap ChangeTracker::update(const MessageInstance& report)
+{
+    FieldBitmap changed;
+    changed.clear();
+
+    const Message* schema = report.getSchema();
+    if (!schema) return changed;
+
+    const BYTE* current = report.getData();
+    int size = schema->getDataSize();
+
+    std::unordered_map<const Message*, Entry>::iterator itr = m_entries.find(schema);
+    if (itr == m_entries.end())
+    {
+        // First report: remember it, every field counts as changed
+        Entry& entry = m_entries[schema];
+        std::memset(entry.fieldOfByte, 0, sizeof(entry.fieldOfByte));
+
+        int idx = 0;
+        for (const MessageField& field : schema->getDataFormat())
+        {
+            std::memset(entry.fieldOfByte + field.getOffset(), std::min(idx, 0xFF), field.getSize());
+            if (idx < MAX_TRACKED_FIELDS) changed.set(idx);
+            idx++;
+        }
+
+        std::memcpy(entry.previous, current, size);
+        entry.lastChanges = changed;
+    }
+    else
+    {
+        Entry& entry = itr->second;
+
+        // XOR 8 bytes at a time, then walk only the bytes that differ
+        for (int i = 0; i < size; i += 8)
+        {
+            uint64_t before = 0, after = 0;
+            int chunk = std::min(8, size - i);
+            std::memcpy(&before, entry.previous + i, chunk);
+            std::memcpy(&after,  current + i,        chunk);
+
+            uint64_t diff = before ^ after;
+            while (diff)
+            {
+                // Host byte k of the chunk is bits 8k..8k+7 of the word (little endian)
+                int bit  = __builtin_ctzll(diff);
+                int byte = HOST_IS_BIG_ENDIAN ? (7 - bit / 8) : (bit / 8);
+                changed.set(entry.fieldOfByte[i + byte]);
+                diff &= ~(uint64_t(0xFF) << (bit & ~7));
+            }
+        }
+
+        if (changed.any()) std::memcpy(entry.previous, current, size);
+        entry.lastChanges = changed;
+    }
+
+    if (changed.any())
+    {
+        for (std::pair<const Message*, ChangeCallback>& callback : m_callbacks)
+            if (callback.first == nullptr || callback.first == schema)
+                callback.second(report, changed);
+    }
+    return changed;
+}
+
+void ChangeTracker::onChange(const Message* schema, ChangeCallback callback)
+{
+    m_callbacks.push_back({schema, callback});
+    m_enabled = true;
+}
+
+FieldBitmap ChangeTracker::getLastChanges(const Message* schema) const
+{
+    std::unordered_map<const Message*, Entry>::const_iterator itr = m_entries.find(schema);
+    if (itr != m_entries.end()) return itr->second.lastChanges;
+
+    FieldBitmap none;
+    none.clear();
+    return none;
+}
+
+void ChangeTracker::reset()
+{
+    m_entries.clear();
+}
@@ -0,0 +1,75 @@
+#ifndef CHANGE_TRACKER_H
+#define CHANGE_TRACKER_H
+
+#include <functional>
+#include <unordered_map>
+
+#include "msg_instance.h"
+
+#define MAX_TRACKED_FIELDS 256
+
+/**
+ * @brief One bit per field of a Message (bit i <-> getDataFormat()[i])
+ */
+struct FieldBitmap
+{
+    uint64_t words[MAX_TRACKED_FIELDS / 64];
+
+    void clear()                { std::memset(words, 0, sizeof(words)); }
+    void set(int idx)           { words[idx / 64] |= uint64_t(1) << (idx % 64); }
+    bool test(int idx)  const   { return idx >= 0 && idx < MAX_TRACKED_FIELDS && (words[idx / 64] >> (idx % 64)) & 1; }
+    bool test(const FieldHandle& handle) const { return test(handle.index); }
+    bool any()          const;
+    int  count()        const;  // number of fields set
+};
+
+// Called with the report just received and which of its fields differ from the previous one
+typedef std::function<void(const MessageInstance& report, const FieldBitmap& changed)> ChangeCallback;
+
+/**
+ * @brief The ChangeTracker remembers the last raw payload of every message it
+ * sees and reports which fields changed since, so monitoring scripts can log
+ * deltas and react to transitions instead of comparing every field by hand.
+ *
+ * Payloads are compared 8 bytes at a time with XOR, only differing bytes are
+ * mapped back to their fields. The first report of a message marks every field.
+ *
+ * handleResponse() feeds the global `changeTracker` once it is enabled (or a
+ * callback is registered). Not thread safe, use one tracker per engine thread.
+ */
+class ChangeTracker
+{
+    public:
+        ChangeTracker() : m_enabled(false) {}
+
+        // Compares `report` with the previous report of the same message, remembers it
+        // and fires the matching callbacks if anything changed.
+        // @return the changed fields
+        FieldBitmap update(const MessageInstance& report);
+
+        // `callback` fires whenever a report of `schema` changes (any message if NULL). Enables the tracker.
+        void onChange(const Message* schema, ChangeCallback callback);
+
+        // Changed fields of the last report of `schema` (all clear if never seen)
+        FieldBitmap getLastChanges(const Message* schema) const;
+
+        void enable(bool enabled)   { m_enabled = enabled; }
+        bool isEnabled()    const   { return m_enabled; }
+        void reset();               // forgets every previous payload (callbacks are kept)
+        void clearCallbacks()       { m_callbacks.clear(); }
+    private:
+        struct Entry
+        {
+            BYTE        previous[MAX_DATA_LEN];
+            BYTE        fieldOfByte[MAX_DATA_LEN];  // data byte -> field index, built on first sight
+            FieldBitmap lastChanges;
+        };
+
+        bool                                            m_enabled;
+        std::unordered_map<const Message*, Entry>       m_entries;      // one per search tag
+        std::vector<std::pair<const Message*, ChangeCallback>> m_callbacks;
+};
+
+extern ChangeTracker changeTracker;
+
+#endif // CHANGE_TRACKER_H
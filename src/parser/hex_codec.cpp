@@ -0,0 +1,109 @@
+#include "hex_codec.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+#endif
+
+// "000102...FEFF", built once at compile time
+struct HexTable
+{
+    char pairs[512];
+    signed char digits[256];    // hex digit -> value, -1 if not a digit
+
+    constexpr HexTable() : pairs(), digits()
+    {
+        const char* alphabet = "0123456789ABCDEF";
+        for (int i = 0; i < 256; i++)
+        {
+            pairs[i*2]     = alphabet[i >> 4];
+            pairs[i*2 + 1] = alphabet[i & 0xF];
+            digits[i]      = -1;
+        }
+        for (int i = 0; i < 10; i++) digits['0' + i] = i;
+        for (int i = 0; i < 6; i++)  {digits['A' + i] = 10 + i; digits['a' + i] = 10 + i;}
+    }
+};
+
+static constexpr HexTable HEX_TABLE;
+
+const char* hexPair(BYTE value)
+{
+    return HEX_TABLE.pairs + value*2;
+}
+
+size_t encodeHex(const BYTE* src, size_t size, char* dst)
+{
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    // 16 bytes -> 32 characters: split nibbles, add '0' or 'A'-10, interleave high/low
+    const __m128i lowMask = _mm_set1_epi8(0x0F);
+    const __m128i nine    = _mm_set1_epi8(9);
+    const __m128i zero    = _mm_set1_epi8('0');
+    const __m128i letter  = _mm_set1_epi8('A' - '0' - 10);
+
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i high  = _mm_and_si128(_mm_srli_epi16(bytes, 4), lowMask);
+        __m128i low   = _mm_and_si128(bytes, lowMask);
+
+        high = _mm_add_epi8(_mm_add_epi8(high, zero), _mm_and_si128(_mm_cmpgt_epi8(high, nine), letter));
+        low  = _mm_add_epi8(_mm_add_epi8(low,  zero), _mm_and_si128(_mm_cmpgt_epi8(low,  nine), letter));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i*2),      _mm_unpacklo_epi8(high, low));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i*2 + 16), _mm_unpackhi_epi8(high, low));
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t nine   = vdupq_n_u8(9);
+    const uint8x16_t zero   = vdupq_n_u8('0');
+    const uint8x16_t letter = vdupq_n_u8('A' - '0' - 10);
+
+    for (; i + 16 <= size; i += 16)
+    {
+        uint8x16_t bytes = vld1q_u8(src + i);
+        uint8x16_t high  = vshrq_n_u8(bytes, 4);
+        uint8x16_t low   = vandq_u8(bytes, vdupq_n_u8(0x0F));
+
+        high = vaddq_u8(vaddq_u8(high, zero), vandq_u8(vcgtq_u8(high, nine), letter));
+        low  = vaddq_u8(vaddq_u8(low,  zero), vandq_u8(vcgtq_u8(low,  nine), letter));
+
+        uint8x16x2_t chars = {{high, low}};
+        vst2q_u8(reinterpret_cast<uint8_t*>(dst + i*2), chars);
+    }
+#endif
+
+    // Leftover bytes
+    for (; i < size; i++)
+    {
+        dst[i*2]     = HEX_TABLE.pairs[src[i]*2];
+        dst[i*2 + 1] = HEX_TABLE.pairs[src[i]*2 + 1];
+    }
+    return size*2;
+}
+
+void encodeHex(const BYTE* src, size_t size, std::string& out)
+{
+    out.resize(size*2);
+    encodeHex(src, size, &out[0]);
+}
+
+int decodeHex(std::string_view hex, BYTE* dst, size_t maxSize)
+{
+    if (hex.size() % 2) return -1;
+
+    size_t count = std::min(hex.size() / 2, maxSize);
+    for (size_t i = 0; i < count; i++)
+    {
+        int high = HEX_TABLE.digits[BYTE(hex[i*2])];
+        int low  = HEX_TABLE.digits[BYTE(hex[i*2 + 1])];
+        if (high < 0 || low < 0) return -1;
+
+        dst[i] = BYTE((high << 4) | low);
+    }
+    return int(count);
+}
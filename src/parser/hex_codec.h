@@ -0,0 +1,29 @@
+#ifndef HEX_CODEC_H
+#define HEX_CODEC_H
+
+#include <string>
+#include <string_view>
+
+#include "byte_order.h"
+
+/*
+ * Hex text <-> bytes, used wherever packets are printed or logged ("10AB00F0...").
+ * Encoding is table driven (SSE2/NEON 16 bytes at a time when the target has them)
+ * and never touches iostream state or the locale. Output is always uppercase.
+ */
+
+// Two hex characters of `value`, not NUL terminated
+const char* hexPair(BYTE value);
+
+// Writes 2*size characters to `dst` (no NUL terminator)
+// @return the number of characters written
+size_t encodeHex(const BYTE* src, size_t size, char* dst);
+
+// Replaces the contents of `out`, its capacity is reused so keep one string per caller
+void encodeHex(const BYTE* src, size_t size, std::string& out);
+
+// Decodes pairs of hex digits (either case), stops at `maxSize` bytes
+// @return bytes written, -1 on an odd length or a non hex character
+int decodeHex(std::string_view hex, BYTE* dst, size_t maxSize);
+
+#endif // HEX_CODEC_H
@@ -1,31 +1,38 @@
 #include "msg.h"
-#include "../serial/lf_comm.h"
 
-Message::Message(xml_node commandNode)
+// Uppercases a copy of `str`, used for the hex fields
+static std::string toUpper(std::string str)
 {
-    m_SearchTag     = commandNode.child("SearchTag").child_value();     // node does not have a value, but instead has a child of type `node_pcdata` with value
-    m_TargetID      = commandNode.child("TargetID").child_value();
-    m_SenderID      = commandNode.child("SenderID").child_value();
-    m_MsgValue      = commandNode.child("MsgValue").child_value();
-    m_MsgName       = commandNode.child("MsgName").child_value();
-
-    // Uppercase all hex fields
-    std::transform(m_SearchTag.begin(), m_SearchTag.end(), m_SearchTag.begin(), ::toupper);
-    std::transform(m_TargetID.begin(), m_TargetID.end(), m_TargetID.begin(), ::toupper);
-    std::transform(m_SenderID.begin(), m_SenderID.end(), m_SenderID.begin(), ::toupper);
-    std::transform(m_MsgValue.begin(), m_MsgValue.end(), m_MsgValue.begin(), ::toupper);    
+    std::transform(str.begin(), str.end(), str.begin(), ::toupper);
+    return str;
+}
+
+Message::Message(xml_node commandNode, SchemaArena& arena, StringPool& strings)
+{
+    // node does not have a value, but instead has a child of type `node_pcdata` with value
+    std::string SearchTag = toUpper(commandNode.child("SearchTag").child_value());  // Uppercase all hex fields
+    std::string TargetID  = toUpper(commandNode.child("TargetID").child_value());
+    std::string SenderID  = toUpper(commandNode.child("SenderID").child_value());
+    std::string MsgValue  = toUpper(commandNode.child("MsgValue").child_value());
+
+    m_SearchTag     = strings.intern(SearchTag);
+    m_TargetID      = strings.intern(TargetID);
+    m_SenderID      = strings.intern(SenderID);
+    m_MsgValue      = strings.intern(MsgValue);
+    m_MsgName       = strings.intern(commandNode.child("MsgName").child_value());
 
     // Converting packet length to base-10 int [HEX->INT]
+    m_PackLen = 0;
     std::istringstream converter(commandNode.child("PackLen").child_value());   
     converter >> std::hex >> m_PackLen;
 
-    m_DuplicateCmd  = commandNode.child("DuplicateCmd").child_value();
+    m_DuplicateCmd  = strings.intern(commandNode.child("DuplicateCmd").child_value());
 
     std::string isBootMode = commandNode.child("IsBootModeCmd").child_value();
     std::transform(isBootMode.begin(), isBootMode.end(), isBootMode.begin(), ::tolower);
     m_IsBootModeCmd = (isBootMode == "true");
     
-    m_CmdNotes      = commandNode.child("CmdNotes").child_value();
+    m_CmdNotes      = strings.intern(commandNode.child("CmdNotes").child_value());
 
     // Data
     std::vector<std::string> DataNames   = split(commandNode.child("DataNames").child_value(),',');
@@ -34,225 +41,175 @@ Message::Message(xml_node commandNode)
     std::vector<std::string> DataDetails = split(commandNode.child("DataDetails").child_value(),',');
     std::vector<std::string> DefaultData = split(commandNode.child("DefaultData").child_value(), ','); // if any
 
-    int j = 0; // DefaultData iterator
+    // All fields of a message sit next to each other in the arena
+    MessageField *fields = arena.allocateArray<MessageField>(DataNames.size());
+    size_t fieldCount = 0;
 
+    m_DataSize = 0;
     for (size_t i = 0; i < DataNames.size(); ++i)
     {
-        std::vector<std::string> defaultDataPerField;
-        if (!DefaultData.empty())
+        int size = DataSizes.size() > i ? std::atoi(DataSizes[i].c_str()) : 0;    // blank sizes (ex. trailing commas) count as 0
+
+        // A MessageInstance can only hold MAX_DATA_LEN bytes
+        if (m_DataSize + size > MAX_DATA_LEN)
+        {
+            std::cout << "WARNING: " << m_MsgName << " fields exceed " << MAX_DATA_LEN << " bytes, ignoring '" << DataNames[i] << "' onwards\n";
+            break;
+        }
+
+        std::string_view type    = strings.intern(DataTypes.size() > i ? DataTypes[i] : std::string());
+        std::string_view details = internDetails(DataDetails.size() > i ? DataDetails[i] : std::string());
+
+        // Bitfields: name their bits from the details (ex. "bit 0 = motor enabled")
+        std::vector<BitName> bits;
+        if (MessageField::stringToType(type) == MessageField::bitfield)
         {
-            int dataSize = std::stoi(DataSizes.size() > i ? DataSizes[i] : std::string("0"));
-            int old_j = j;
-            while (j < int(DefaultData.size()) && j < old_j+dataSize)    // append to defaultData
+            for (const std::string& line : split(std::string(details), '\n'))
             {
-                defaultDataPerField.push_back(DefaultData[j]);
-                j++;
+                BitName entry;
+                if (MessageField::parseBitName(line, entry.bit, entry.name) && entry.bit < size * 8)
+                {
+                    entry.name = strings.intern(entry.name);
+                    bits.push_back(entry);
+                }
             }
         }
+        BitName *bitNames = arena.allocateArray<BitName>(bits.size());
+        std::copy(bits.begin(), bits.end(), bitNames);
 
-        data_format.push_back(new MessageField(  DataNames.size() > i      ?   DataNames[i]    : std::string(),
-                                                 DataTypes.size() > i      ?   DataTypes[i]    : std::string(),
-                                                 DataSizes.size() > i      ?   DataSizes[i]    : std::string(),
-                                                 DataDetails.size() > i    ?   DataDetails[i]  : std::string(),
-                                                 defaultDataPerField));
+        new (&fields[fieldCount++]) MessageField(strings.intern(DataNames[i]),
+                                                 type,
+                                                 size,
+                                                 details,
+                                                 ArenaArray<const BitName>(bitNames, bits.size()),
+                                                 m_DataSize);
+        m_DataSize += size;
     }
-}
+    data_format = ArenaArray<const MessageField>(fields, fieldCount);
 
-comm_error Message::sendMessage()
-{
-    if (!this->isOutgoing())
+    // Default data bytes (if any), missing bytes are zeroed
+    BYTE *defaultData = arena.allocateArray<BYTE>(m_DataSize);
+    std::memset(defaultData, 0, m_DataSize);
+    for (size_t i = 0; i < DefaultData.size() && int(i) < m_DataSize; ++i)
     {
-        std::cout << getMsgName() << " is NOT an outgoing message...";
-        return INVALID_MSG;
+        int hexResult;
+        // Converting default byte to base-10 int [HEX->INT]
+        std::istringstream converter(DefaultData[i]);
+        converter >> std::hex >> hexResult;
+        defaultData[i] = static_cast<BYTE>(hexResult);
     }
-    if (!sendPacket(this)) 
-    {
-        std::cout << "ERROR: sendPacket() failed with error: " << serialComm.errorState << '\n';
-        return serialComm.errorState;
-    }
-
-    handleResponse();
-    return NONE;
-}
+    m_DefaultData = defaultData;
 
-std::vector<BYTE> Message::getHeader()
-{// TARGET ID, LENGTH, SEQUENCE, SENDER ID, MSG CODE
-    std::vector<BYTE> header;
-    int hexResult;
+    // Header bytes never change: TARGET ID, LENGTH, SEQUENCE, SENDER ID, MSG CODE
+    int hexResult = 0;
+    std::istringstream(TargetID) >> std::hex >> hexResult;
+    m_Header[0] = static_cast<BYTE>(hexResult);
 
-    // TARGET ID
-    std::istringstream(m_TargetID) >> std::hex >> hexResult;
-    header.push_back(static_cast<BYTE>(hexResult));
+    m_Header[1] = static_cast<BYTE>(m_PackLen);
 
-    // LENGTH
-    header.push_back(static_cast<BYTE>(m_PackLen));
+    m_Header[2] = BYTE(0x00);   // SEQUENCE (UNIMPLEMENTED)
 
-    // SEQUENCE (UNIMPLEMENTED)
-    header.push_back(BYTE(0x00));
+    hexResult = 0;
+    std::istringstream(SenderID) >> std::hex >> hexResult;
+    m_Header[3] = static_cast<BYTE>(hexResult);
 
-    // SENDER ID
-    std::istringstream(m_SenderID) >> std::hex >> hexResult;
-    header.push_back(static_cast<BYTE>(hexResult));
+    hexResult = 0;
+    std::istringstream(MsgValue) >> std::hex >> hexResult;
+    m_Header[4] = static_cast<BYTE>(hexResult);
 
-    // MSG CODE
-    std::istringstream(m_MsgValue) >> std::hex >> hexResult;
-    header.push_back(static_cast<BYTE>(hexResult));
+    // Starting point of every instance's running checksum (see MessageInstance::getChecksum())
+    m_HeaderSum = 0;
+    for (int i = 0; i < HEADER_LEN; i++) m_HeaderSum += m_Header[i];
 
-    return header;
+    m_DefaultSum = m_HeaderSum;
+    for (int i = 0; i < m_DataSize; i++) m_DefaultSum += m_DefaultData[i];
 }
 
-std::vector<BYTE> Message::getDataBuffer()
+size_t Message::arenaSizeHint(xml_node commandNode)
 {
-    std::vector<BYTE> buffer;
-    for (MessageField*& piece : data_format)
-    {
-        std::vector<BYTE> piece_data = piece->getData();
-        for (BYTE& byte : piece_data)
-            buffer.push_back(byte);
-    }
-    return buffer;
-}
-
-/* Algorithm for message checksum:
-*  Two's complement of the sum of the header and data bytes.
-*
-*  In other words, take the sum of all bytes in a packet (except the CS) and negate it.
-*/
-BYTE Message::getChecksum()
-{
-    std::vector<BYTE> messageBufferNoCS;
-
-    std::vector<BYTE> headerBytes = this->getHeader();
-    std::vector<BYTE> dataBytes = this->getDataBuffer();
+    // Every string interned by the constructor is a piece of one of these values
+    // (DataDetails goes to the shared detail pool instead, only bit names are kept)
+    static const char* internedNodes[] = {"SearchTag", "TargetID", "SenderID", "MsgValue", "MsgName",
+                                          "DuplicateCmd", "CmdNotes", "DataNames", "DataTypes"};
+    size_t textBytes = 0;
+    for (const char* node : internedNodes)
+        textBytes += std::strlen(commandNode.child(node).child_value());
 
-    messageBufferNoCS.insert(messageBufferNoCS.end(), headerBytes.begin(), headerBytes.end());
-    messageBufferNoCS.insert(messageBufferNoCS.end(), dataBytes.begin(), dataBytes.end());
+    std::string names   = commandNode.child("DataNames").child_value();
+    std::string details = commandNode.child("DataDetails").child_value();
+    size_t fields       = std::count(names.begin(), names.end(), ',') + 1;
+    size_t lines        = std::count(details.begin(), details.end(), '\n') + fields;   // upper bound of named bits
 
-    BYTE checksum = 0;
+    int dataSize = 0;
+    for (const std::string& size : split(commandNode.child("DataSizes").child_value(), ','))
+        dataSize += std::atoi(size.c_str());
 
-	for (const BYTE& b : messageBufferNoCS)
-        checksum += b;
-
-	return -1*checksum;
+    return sizeof(Message)      + alignof(Message)
+         + sizeof(MessageField) * fields + alignof(MessageField)
+         + sizeof(BitName) * lines + alignof(BitName) * fields + details.size()
+         + std::min(std::max(dataSize, 0), MAX_DATA_LEN)   // default data
+         + textBytes;
 }
 
-std::vector<BYTE> Message::getMessageBuffer()
-{
-    std::vector<BYTE> message;
-
-    // Header bytes
-    std::vector<BYTE> headerBytes = getHeader();
-    message.insert(message.end(), headerBytes.begin(), headerBytes.end());
-
-    // Data buffer
-    std::vector<BYTE> dataBytes = getDataBuffer();
-    message.insert(message.end(), dataBytes.begin(), dataBytes.end());
-
-    // CS
-    message.push_back(this->getChecksum());
-
-    return message;
-}
-
-MessageField* Message::findMessageField(std::string fieldName)
+const MessageField* Message::findMessageField(std::string fieldName) const
 {
     std::transform(fieldName.begin(), fieldName.end(), fieldName.begin(), ::toupper);
     std::string currentName;
     
-    MessageField *desired = nullptr;
-    for (MessageField*& entry : data_format)
+    const MessageField *desired = nullptr;
+    for (const MessageField& entry : data_format)
     {
-        currentName = entry->getName();
+        currentName = entry.getName();
         std::transform(currentName.begin(), currentName.end(), currentName.begin(), ::toupper);
-        if (currentName == fieldName) {desired = entry; break;} 
+        if (currentName == fieldName) {desired = &entry; break;} 
     }
 
     if (desired == nullptr) {std::cout << "ERROR: Message field '" << fieldName << "' not found..." << '\n';}
     return desired;
 }
 
-std::string Message::getMsgDirectionStr()
+FieldHandle Message::getFieldHandle(const std::string& fieldName) const
 {
-    return deviceIDtoStr(m_SenderID) + " --> " + deviceIDtoStr(m_TargetID);
-}
+    const MessageField *field = findMessageField(fieldName);
+    if (!field) return {nullptr, -1};
 
-void Message::setSearchTag (std::string SearchTag)
-{
-    if (checkSearchTag(SearchTag))
-    {
-        m_SearchTag = SearchTag;
-        std::transform(m_SearchTag.begin(), m_SearchTag.end(), m_SearchTag.begin(), ::toupper);
-        updateSearchTag(fromSearchTag);
-    }
+    return {this, int(field - data_format.begin())};
 }
 
-void Message::setTargetID (std::string TargetID)
+FieldHandle Message::getFieldHandle(int index) const
 {
-    if (checkByteInput(TargetID))
-    {
-        m_TargetID  = TargetID;
-        std::transform(m_TargetID.begin(), m_TargetID.end(), m_TargetID.begin(), ::toupper);
-        updateSearchTag(fromID);
-    }
+    if (index < 0 || index >= int(data_format.size())) {std::cout << "ERROR: Message field #" << index << " not found..." << '\n'; return {nullptr, -1};}
+
+    return {this, index};
 }
 
-void Message::setSenderID (std::string SenderID)
+BitMask Message::getBitMask(const std::string& fieldName, const std::string& bitName) const
 {
-    if (checkByteInput(SenderID))
-    {
-        m_SenderID  = SenderID;
-        std::transform(m_SenderID.begin(), m_SenderID.end(), m_SenderID.begin(), ::toupper);
-        updateSearchTag(fromID);
-    }
+    const MessageField *field = findMessageField(fieldName);
+    if (!field) return {-1, 0};
+
+    int bit = field->findBit(bitName);
+    if (bit < 0) {std::cout << "ERROR: Bit '" << bitName << "' not found in '" << fieldName << "'..." << '\n'; return {-1, 0};}
+
+    return field->getBitMask(bit);
 }
 
-void Message::setMsgValue (std::string MsgValue)
+BitMask Message::getBitMask(const std::string& fieldName, int bit) const
 {
-    if (checkByteInput(MsgValue))
-    {
-        m_MsgValue = MsgValue;
-        std::transform(m_MsgValue.begin(), m_MsgValue.end(), m_MsgValue.begin(), ::toupper);
-        updateSearchTag(fromID);
-    }
+    const MessageField *field = findMessageField(fieldName);
+    if (!field) return {-1, 0};
+
+    BitMask mask = field->getBitMask(bit);
+    if (!mask.isValid()) {std::cout << "ERROR: Bit " << bit << " out of range for '" << fieldName << "'..." << '\n';}
+    return mask;
 }
 
-void Message::updateSearchTag(searchTagUpdate type)
+std::string Message::getMsgDirectionStr() const
 {
-    switch (type)
-    {
-        case fromSearchTag:
-        {
-            std::vector<std::string> ids = split(m_SearchTag, ':');
-            if (ids.size() == 3 || ids.size() == 4)
-            {
-                m_TargetID = ids[0];
-                m_SenderID = ids[1];
-                m_MsgValue = ids[2];
-                if (ids.size() == 4)
-                    m_PackLen = std::stoi(ids[3]);
-            }
-        }
-            break;
-        case fromID:
-        {
-            std::string newSearchTag;
-            newSearchTag += m_TargetID;
-            newSearchTag += ":" + m_SenderID;
-            newSearchTag += ":" + m_MsgValue;
-            if (split(m_SearchTag, ':').size() == 4)
-            {
-                std::stringstream ss;
-                ss << std::hex << m_PackLen;
-                std::string hex = ss.str();
-                std::transform(hex.begin(), hex.end(), hex.begin(), ::toupper);
-            }
-            m_SearchTag = newSearchTag;
-        }
-            break;
-    }
+    return deviceIDtoStr(m_SenderID) + " --> " + deviceIDtoStr(m_TargetID);
 }
 
-std::string Message::deviceIDtoStr(const std::string& id)
+std::string Message::deviceIDtoStr(std::string_view id)
 {
     if (id == "10") return std::string("PTC_HS");
     if (id == "11") return std::string("PTC_LS");
@@ -267,187 +224,13 @@ std::string Message::deviceIDtoStr(const std::string& id)
     return std::string("n/a");
 }
 
-bool Message::checkSearchTag(std::string& st)
-{
-    std::vector<std::string> ids = split(st, ':');
-    if (ids.size() == 3 || ids.size() == 4)
-    {
-        bool ok = 1;
-        for (std::string id : ids)
-        {
-            ok &= (id.length() == 2);
-
-            // checking valid hex input
-            if (!std::all_of(id.begin(), id.end(), ::isxdigit)) 
-            {
-                std::cerr << "Bad input: " << st << '\n';
-                return false;
-            }
-
-            std::istringstream hexToInt(id);
-            uint hex;
-            hexToInt >> std::hex >> hex;
-            ok &= (hex < 256 && hex >= 0);
-        }
-        if (ok)
-        {
-            return true;
-        }
-    }
-    std::cerr << "Bad search tag: " << st << '\n';
-    return false;
-}
-
-bool Message::checkByteInput(std::string& str)
-{
-    bool ok = 1;
-
-    // checking valid hex input
-    if (!std::all_of(str.begin(), str.end(), ::isxdigit)) 
-    {
-        std::cerr << "Bad input: " << str << '\n';
-        return false;
-    }
-
-    std::istringstream hexToInt(str);
-    uint hex;
-    hexToInt >> std::hex >> hex;
-    ok &= (hex < 256 && hex >= 0);
-    if (!ok)
-    {
-        std::cerr << "Bad input: " << str << '\n';
-    }
-    return ok;
-}
-
-void Message::printMsg()
+void Message::printMsg() const
 {
     std::cout << m_SearchTag << " | " << m_TargetID << m_SenderID << m_MsgValue << '\n';
     std::cout << m_MsgName << " PackLen: " << m_PackLen << '\n';
 
-    for (MessageField* piece : data_format)
+    for (const MessageField& piece : data_format)
     {
-        piece->printMsgField();
+        piece.printMsgField();
     }
 }
-
-void Message::setDataBuffer(const std::vector<BYTE>& newBuffer)
-{
-    // Size mismatch: copy over the first bytes from newBuffer
-    if (int(newBuffer.size()) != (m_PackLen - MIN_PACK_LEN)) {return;}
-
-    int byteIdx = 0;
-    for (MessageField *& piece : data_format)
-    {
-        piece->setData(std::vector<BYTE>(newBuffer.begin() + byteIdx, newBuffer.begin() + byteIdx + piece->getSize()));
-        byteIdx += piece->getSize();
-    }
-}
-
-template<typename T>
-T stitchIntBytes(std::vector<BYTE> bytes)   // Helper function for stiching int based bytes
-{
-    T stichedInt;
-    std::reverse(bytes.begin(), bytes.end());   // to correct for processor endianness
-    std::memcpy(&stichedInt, bytes.data(), sizeof(T));
-    return stichedInt;
-}
-
-// Template specializations for getField(std::string)
-template<> // bitfield byte, byte
-BYTE Message::getField<BYTE>(const std::string& dataName)
-{
-    /* find the field */
-    MessageField *toRead = findMessageField(dataName);
-    if (!toRead) return BYTE();
-
-    /* stitch the bytes */
-    return toRead->getData()[0];
-}
-
-template<> // word
-uint16_t Message::getField<uint16_t>(const std::string& dataName)
-{
-    /* find the field */
-    MessageField *toRead = findMessageField(dataName);
-    if (!toRead) return uint16_t();
-
-    /* stitch the bytes */
-    return stitchIntBytes<uint16_t>(toRead->getData());
-}
-
-template<> // string
-std::string Message::getField<std::string>(const std::string& dataName)
-{
-    /* find the field */
-    MessageField *toRead = findMessageField(dataName);
-    if (!toRead) return std::string();
-
-    std::vector<BYTE> localBytes = toRead->getData();
-    /* stitch the bytes */
-    return std::string(localBytes.begin(), localBytes.end());
-}
-
-template<> // long
-uint32_t Message::getField<uint32_t>(const std::string& dataName)
-{
-    /* find the field */
-    MessageField *toRead = findMessageField(dataName);
-    if (!toRead) return uint32_t();
-
-    /* stitch the bytes */
-    return stitchIntBytes<uint32_t>(toRead->getData());
-}
-
-template<> // signed word
-int16_t Message::getField<int16_t>(const std::string& dataName)
-{
-    /* find the field */
-    MessageField *toRead = findMessageField(dataName);
-    if (!toRead) return int16_t();
-
-    /* stitch the bytes */
-    return stitchIntBytes<int16_t>(toRead->getData());
-}
-
-template<> // byteS
-BYTE* Message::getField<BYTE*>(const std::string& dataName)
-{
-    /* find the field */
-    MessageField *toRead = findMessageField(dataName);
-    if (!toRead) return int16_t();
-
-    /* stitch the bytes */
-    return toRead->getData().data();
-}
-
-template<> // wordS: vector of uint16_t
-std::vector<uint16_t> Message::getField<std::vector<uint16_t>>(const std::string& dataName)
-{
-    /* find the field */
-    MessageField *toRead = findMessageField(dataName);
-    if (!toRead) return std::vector<uint16_t>();
-
-    /* stitch the bytes */
-    std::vector<BYTE> bytes = toRead->getData();
-    std::vector<uint16_t> result(toRead->getSize() / 2, 0);
-    for (int i = 0; i < (toRead->getSize() / 2); i++)
-    {
-        size_t byteIdx = i*2;
-        std::vector<BYTE> currentTwoBytes = {bytes[byteIdx], bytes[byteIdx+1]};
-
-        result[i] = stitchIntBytes<uint16_t>(currentTwoBytes);
-    }
-    return result;
-}
-
-template<> // long long
-uint64_t Message::getField<uint64_t>(const std::string& dataName)
-{
-    /* find the field */
-    MessageField *toRead = findMessageField(dataName);
-    if (!toRead) return uint64_t();
-
-    /* stitch the bytes */
-    return stitchIntBytes<uint64_t>(toRead->getData());
-}
\ No newline at end of file
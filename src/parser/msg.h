@@ -8,14 +8,31 @@
 #include <cstring>
 
 #define MIN_PACK_LEN 6
+#define HEADER_LEN   5
+#define MAX_DATA_LEN (0x100 - MIN_PACK_LEN)   // PackLen is a single byte
 
 using namespace pugi;
 
+class Message;
+
+// A field resolved once by Message::getFieldHandle(), lets MessageInstance::getValue() skip the name lookup
+struct FieldHandle
+{
+    const Message* schema;
+    int            index;       // into getDataFormat()
+
+    bool isValid() const { return schema != nullptr && index >= 0; }
+};
+
 /**
  * @brief The Message class is the blueprint of any sent (TX) or received (RX)
  * packet through the UART cable. The representation of each command or report
  * follows a pattern detailed at the end of this file. A Message object uses
- * multiple MessageField containers to hold the data.
+ * multiple MessageField descriptors to describe the data.
+ *
+ * A Message is an immutable schema: it is built once from the XML and then only
+ * read, so the same Message may be shared by any number of threads or sessions.
+ * The actual bytes of a packet live in a MessageInstance (see msg_instance.h).
  * 
  * Each message can be broken down as shown below with '|' seperating byte(s):
  * 
@@ -27,88 +44,73 @@ using namespace pugi;
 class Message
 {
     public:
-        Message(xml_node commandNode);
+        // Builds the schema inside `arena`, strings are interned through `strings`
+        Message(xml_node commandNode, SchemaArena& arena, StringPool& strings);
 
-        // Object-based function for sending a message
-        // @return a type of error, see serial/comm_errors.h, usually 0 on success
-        comm_error sendMessage();
+        // Upper bound of arena bytes the constructor above needs for `commandNode`
+        static size_t arenaSizeHint(xml_node commandNode);
 
         // Getters
-        std::string getSearchTag()              { return m_SearchTag    ; }
-        std::string getMsgName()                { return m_MsgName      ; }
-        std::string getTargetID()               { return m_TargetID     ; }
-        std::string getSenderID()               { return m_SenderID     ; }
-        std::string getMsgValue()               { return m_MsgValue     ; }
-        int         getPackLen()                { return m_PackLen      ; }
-        bool        getIsBootModeCmd()          { return m_IsBootModeCmd; }
-        std::string getDuplicateCmd()           { return m_DuplicateCmd ; }
-        std::string getCmdNotes()               { return m_CmdNotes     ; }
-        std::vector<MessageField*>& getDataFormat()   { return data_format; }
+        std::string_view getSearchTag()         const { return m_SearchTag    ; }
+        std::string_view getMsgName()           const { return m_MsgName      ; }
+        std::string_view getTargetID()          const { return m_TargetID     ; }
+        std::string_view getSenderID()          const { return m_SenderID     ; }
+        std::string_view getMsgValue()          const { return m_MsgValue     ; }
+        int         getPackLen()                const { return m_PackLen      ; }
+        bool        getIsBootModeCmd()          const { return m_IsBootModeCmd; }
+        std::string_view getDuplicateCmd()      const { return m_DuplicateCmd ; }
+        std::string_view getCmdNotes()          const { return m_CmdNotes     ; }
+        const ArenaArray<const MessageField>& getDataFormat() const { return data_format; }
+
+        const BYTE*     getHeader()      const { return m_Header     ; }   // HEADER_LEN bytes
+        int             getDataSize()    const { return m_DataSize   ; }   // sum of all field sizes
+        const BYTE*     getDefaultData() const { return m_DefaultData; }   // getDataSize() initial data bytes of a new instance
+        BYTE            getHeaderSum()   const { return m_HeaderSum  ; }   // header bytes added up (mod 256)
+        BYTE            getDefaultSum()  const { return m_DefaultSum ; }   // header and default data bytes added up, negated it is the checksum
+
+        const MessageField* findMessageField(std::string fieldName) const;  // returns NULL if not found and prints ERROR message
+
+        // Resolves a field (case insensitive name, or its position) for MessageInstance::getValue()
+        // Returns an invalid handle (and prints ERROR message) if not found
+        FieldHandle getFieldHandle(const std::string& fieldName) const;
+        FieldHandle getFieldHandle(int index) const;
+
+        // Resolves a bit of a bitfield into a mask usable on any instance of this message,
+        // by the name found in the field's details (case insensitive) or by bit number.
+        // Returns an invalid mask (and prints ERROR message) if not found
+        BitMask getBitMask(const std::string& fieldName, const std::string& bitName) const;
+        BitMask getBitMask(const std::string& fieldName, int bit) const;
 
-        std::vector<BYTE> getHeader();
-        std::vector<BYTE> getDataBuffer();                      // data bytes
-        BYTE              getChecksum();
-        std::vector<BYTE> getMessageBuffer();                   // includes all bytes within the message
 
-        MessageField* findMessageField(std::string fieldName);  // returns NULL if not found and prints ERROR message
+        // Formatted Strings
+        std::string getMsgLengthStr()       const { return std::to_string(m_PackLen); }
+        std::string getMsgDirectionStr()    const;
+        std::string getMsgFieldCountStr()   const { return std::to_string(data_format.size()); }
 
+        bool isOutgoing()   const { return m_SenderID == std::string("F0");}  // 0xF0 is the ID for console
+        bool isEditable()   const { return this->isOutgoing() && m_DataSize != 0; }
 
-        // Formatted Strings
-        std::string getMsgLengthStr()       { return std::to_string(m_PackLen); }
-        std::string getMsgDirectionStr();
-        std::string getMsgFieldCountStr()   { return std::to_string(data_format.size()); }
-
-        // Setters
-        void setSearchTag     (std::string SearchTag    );
-        void setTargetID      (std::string TargetID     );
-        void setSenderID      (std::string SenderID     );
-        void setMsgValue      (std::string MsgValue     );
-        void setMsgName       (std::string MsgName      ) {      m_MsgName  = MsgName      ; }
-        void setPackLen       (int     PackLen      )     {      m_PackLen  = PackLen      ; }
-        void setIsBootModeCmd (bool    IsBootModeCmd)     {m_IsBootModeCmd  = IsBootModeCmd; }
-        void setDuplicateCmd  (std::string DuplicateCmd ) { m_DuplicateCmd  = DuplicateCmd ; }
-        void setCmdNotes      (std::string CmdNotes     ) {     m_CmdNotes  = CmdNotes     ; }
-
-        void setDataBuffer    (const std::vector<BYTE>& newBuffer);
-
-        bool isOutgoing()   { return m_SenderID == std::string("F0");}  // 0xF0 is the ID for console
-        bool isEditable()   { return this->isOutgoing() && this->getDataBuffer().size() != 0; }
-
-        /**
-         * Sets the value of a field identified by `dataName` to the value provided in `input`.
-         * The field type `T` is later casted to the type of DataName with the use of helper functions.
-         * 
-         * @tparam T The type of the input value.
-         * @param dataName The identifier of the data field to be set.
-         * @param input The value to set for the data field.
-         * @return true if the field was successfully set, false otherwise.
-         */
-        template <typename T>
-        bool setField(const std::string& dataName, const T& input);
-
-        template <typename T>
-        T getField(const std::string& dataName);
-
-        void printMsg();
+        void printMsg() const;
     private:
-        std::string m_SearchTag;            // DESTINATION:SOURCE:MSG_CODE
-        std::string m_TargetID;             // Destination ID
-        std::string m_SenderID;             // Source ID
-        std::string m_MsgValue;             // MSG Code (identifier)
-        std::string m_MsgName;
-        int         m_PackLen;              // Total # of bytes in the packet
-
-        std::vector<MessageField*> data_format;
-
-        bool        m_IsBootModeCmd;
-        std::string m_DuplicateCmd;   //unused??
-        std::string m_CmdNotes;       
-
-        enum searchTagUpdate{ fromSearchTag, fromID };
-        void updateSearchTag(searchTagUpdate type);
-        std::string deviceIDtoStr(const std::string& id);
-        bool checkSearchTag(std::string& st);
-        bool checkByteInput(std::string& str);
+        std::string_view m_SearchTag;       // DESTINATION:SOURCE:MSG_CODE
+        std::string_view m_TargetID;        // Destination ID
+        std::string_view m_SenderID;        // Source ID
+        std::string_view m_MsgValue;        // MSG Code (identifier)
+        std::string_view m_MsgName;
+        int              m_PackLen;         // Total # of bytes in the packet
+
+        ArenaArray<const MessageField> data_format;    // fields are stored back to back in the arena
+        int               m_DataSize;       // In bytes
+        BYTE              m_Header[HEADER_LEN];
+        const BYTE*       m_DefaultData;
+        BYTE              m_HeaderSum;
+        BYTE              m_DefaultSum;
+
+        bool             m_IsBootModeCmd;
+        std::string_view m_DuplicateCmd;   //unused??
+        std::string_view m_CmdNotes;       
+
+        static std::string deviceIDtoStr(std::string_view id);
 };
 
 /*
@@ -167,25 +169,5 @@ std::vector<BYTE> fetchBytes(const T& input, int num, const bool& flip)
     return data;
 }
 
-template <typename T>
-bool Message::setField(const std::string& dataName, const T& input) // linker does not want this to be defined anywhere else...
-{
-    if (!this->isEditable()) {std::cout << "ERROR: Message field '" <<  dataName << "' not editable..." << '\n'; return false;}
-
-    /* find the relevant MessageField */
-    MessageField *toModify = this->findMessageField(dataName); 
-    if (!toModify) {return false;}
-
-    /* modify the data */
-    std::vector<BYTE> newBytes;
-
-    // `string` and `bytes` types have to be flipped to match correct bit ordering
-    if (toModify->getTypeEnum() == MessageField::string || toModify->getTypeEnum() == MessageField::bytes) newBytes = fetchBytes(input, toModify->getSize(), true);
-    else newBytes = fetchBytes(input, toModify->getSize(), false);
-
-    toModify->setData(newBytes);
-    return true;
-}
-
 #endif // MSG_H
 
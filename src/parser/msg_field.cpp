@@ -1,33 +1,109 @@
 #include "msg_field.h"
+#include "hex_codec.h"
 
-MessageField::MessageField(std::string name, std::string type, std::string size, std::string detail, std::vector<std::string> defaultData)
-    : m_name(name), m_type(type), m_size(std::stoi(size))
+MessageField::MessageField(std::string_view name, std::string_view type, int size, std::string_view details, ArenaArray<const BitName> bits, int offset)
+    : m_name(name), m_type(type), m_typeEnum(stringToType(type)), m_size(size), m_offset(offset),
+      m_details(details), m_bits(bits), m_decoder(selectDecoder(m_typeEnum, size))
 {
-    m_typeEnum = stringToType(m_type);
-    m_details = split(detail, '\n');
+}
+
+/* Decoders ==================================================================================
+ * One per type (and a fallback for integer fields whose size doesn't match their type), so a
+ * field is decoded with a single indirect call instead of comparing type names on each read.
+ */
+static FieldValue decodeNone      (const BYTE*,       int)      { return std::monostate(); }
+static FieldValue decodeByte      (const BYTE* field, int)      { return uint8_t(field[0]); }
+static FieldValue decodeSignedByte(const BYTE* field, int)      { return int8_t(field[0]); }
+static FieldValue decodeWord      (const BYTE* field, int)      { return loadBigEndian<uint16_t>(field); }
+static FieldValue decodeSignedWord(const BYTE* field, int)      { return int16_t(loadBigEndian<uint16_t>(field)); }
+static FieldValue decodeLong      (const BYTE* field, int)      { return loadBigEndian<uint32_t>(field); }
+static FieldValue decodeLongLong  (const BYTE* field, int)      { return loadBigEndian<uint64_t>(field); }
+static FieldValue decodeString    (const BYTE* field, int size) { return std::string_view(reinterpret_cast<const char*>(field), size); }
+static FieldValue decodeBytesView (const BYTE* field, int size) { return BytesView{field, size}; }
+static FieldValue decodeWordsView (const BYTE* field, int size) { return WordsView{field, size / 2}; }
+
+// Integer fields declared with an unusual size, high bytes that don't fit are dropped
+static FieldValue decodeAnyWord      (const BYTE* field, int size) { return uint16_t(loadBigEndian(field, size)); }
+static FieldValue decodeAnySignedWord(const BYTE* field, int size) { return int16_t(loadBigEndian(field, size)); }
+static FieldValue decodeAnyLong      (const BYTE* field, int size) { return uint32_t(loadBigEndian(field, size)); }
+static FieldValue decodeAnyLongLong  (const BYTE* field, int size) { return uint64_t(loadBigEndian(field, size)); }
+
+MessageField::Decoder MessageField::selectDecoder(PacketItem_t type, int size)
+{
+    // Indexed by PacketItem_t: {decoder for the expected size, expected size, decoder for any other size}
+    static const struct { Decoder exact; int size; Decoder other; } table[maxTypes] = {
+        /* none        */ {decodeNone,       0, decodeNone         },
+        /* bitfield    */ {decodeByte,       1, decodeByte         },
+        /* byte        */ {decodeByte,       1, decodeByte         },
+        /* word        */ {decodeWord,       2, decodeAnyWord      },
+        /* string      */ {decodeString,     0, decodeString       },
+        /* longInt     */ {decodeLong,       4, decodeAnyLong      },
+        /* signedWord  */ {decodeSignedWord, 2, decodeAnySignedWord},
+        /* bytes       */ {decodeBytesView,  0, decodeBytesView    },
+        /* words       */ {decodeWordsView,  0, decodeWordsView    },
+        /* long_long   */ {decodeLongLong,   8, decodeAnyLongLong  },
+        /* signedByte  */ {decodeSignedByte, 1, decodeSignedByte   },
+    };
+
+    if (type <= none || type >= maxTypes || size <= 0) return decodeNone;
+    if (table[type].size == 0 || table[type].size == size) return table[type].exact;
+    return table[type].other;
+}
+
+int WordsView::copyTo(uint16_t* out, int maxCount) const
+{
+    int words = std::min(count, maxCount);
+    decodeWords(data, out, words);
+    return words;
+}
 
-    if (!defaultData.empty())
+std::string fieldValueToString(const FieldValue& value)
+{
+    std::string text;
+
+    switch (value.index())
     {
-        for (std::string dataField : defaultData)
+        case 1: return std::to_string(std::get<uint8_t>(value));
+        case 2: return std::to_string(std::get<int8_t>(value));
+        case 3: return std::to_string(std::get<uint16_t>(value));
+        case 4: return std::to_string(std::get<int16_t>(value));
+        case 5: return std::to_string(std::get<uint32_t>(value));
+        case 6: return std::to_string(std::get<uint64_t>(value));
+        case 7: return std::string(std::get<std::string_view>(value));
+        case 8:
         {
-            int hexResult;
-            // Converting packet length to base-10 int [HEX->INT]
-            std::istringstream converter(dataField);   
-            converter >> std::hex >> hexResult;
-            m_data.push_back(static_cast<BYTE>(hexResult));
+            const BytesView& bytes = std::get<BytesView>(value);
+            encodeHex(bytes.data, bytes.size, text);
+            return text;
         }
+        case 9:
+        {
+            // Words are big endian in the packet, so each one is its two bytes in order
+            const WordsView& words = std::get<WordsView>(value);
+            text.reserve(words.count * 5);
+            for (int i = 0; i < words.count; i++)
+            {
+                if (i) text += ' ';
+                text.append(hexPair(words.data[i*2]), 2).append(hexPair(words.data[i*2 + 1]), 2);
+            }
+            return text;
+        }
+        default: return text;
     }
-    else
-        m_data = std::vector<BYTE>(std::stoi(size), 0);
 }
 
-MessageField::MessageField(std::string name, std::string type, std::string size, std::string detail)
-    : m_name(name), m_type(type), m_size(std::stoi(size))
+bool fieldValueToInt(const FieldValue& value, int64_t& out)
 {
-    m_typeEnum = stringToType(m_type);
-    m_details = split(detail, '\n');
-
-    m_data = std::vector<BYTE>(std::stoi(size), 0);
+    switch (value.index())
+    {
+        case 1: out = std::get<uint8_t>(value);           return true;
+        case 2: out = std::get<int8_t>(value);            return true;
+        case 3: out = std::get<uint16_t>(value);          return true;
+        case 4: out = std::get<int16_t>(value);           return true;
+        case 5: out = std::get<uint32_t>(value);          return true;
+        case 6: out = int64_t(std::get<uint64_t>(value)); return true;
+        default: return false;
+    }
 }
 
 std::vector<std::string> split(const std::string& str, const char& delimiter)
@@ -44,30 +120,74 @@ std::vector<std::string> split(const std::string& str, const char& delimiter)
     return elems;
 }
 
-std::string MessageField::getName()
-{
-    return m_name;
-}
-std::string MessageField::getType()
+std::vector<std::string_view> MessageField::getDetails() const
 {
-    return m_type;
-}
-MessageField::PacketItem_t MessageField::getTypeEnum()
-{
-    return m_typeEnum;
+    std::vector<std::string_view> lines;
+
+    size_t start = 0;
+    while (start < m_details.size())
+    {
+        size_t end = m_details.find('\n', start);
+        if (end == std::string_view::npos) end = m_details.size();
+
+        lines.push_back(m_details.substr(start, end - start));
+        start = end + 1;
+    }
+
+    return lines;
 }
-int     MessageField::getSize()
+
+int MessageField::findBit(std::string_view bitName) const
 {
-    return m_size;
+    for (const BitName& entry : m_bits)
+    {
+        if (entry.name.size() == bitName.size() &&
+            std::equal(entry.name.begin(), entry.name.end(), bitName.begin(),
+                       [](char a, char b) { return ::tolower(a) == ::tolower(b); }))
+            return entry.bit;
+    }
+    return -1;
 }
-std::vector<std::string> MessageField::getDetails()
+
+BitMask MessageField::getBitMask(int bit) const
 {
-    return m_details;
+    if (bit < 0 || bit >= m_size * 8) return {-1, 0};
+
+    // Multi-byte fields are big endian: bit 0 lives in the last byte
+    return {m_offset + (m_size - 1 - bit / 8), BYTE(1 << (bit % 8))};
 }
 
-std::vector<BYTE> MessageField::getData()
+bool MessageField::parseBitName(std::string_view line, int& bit, std::string_view& name)
 {
-    return m_data;
+    size_t idx = 0;
+    auto skipSpaces = [&]() { while (idx < line.size() && ::isspace((unsigned char)line[idx])) idx++; };
+
+    // "bit" or "b"
+    skipSpaces();
+    if (idx >= line.size() || ::tolower(line[idx]) != 'b') return false;
+    idx++;
+    if (idx + 1 < line.size() && ::tolower(line[idx]) == 'i' && ::tolower(line[idx+1]) == 't') idx += 2;
+
+    // bit number
+    skipSpaces();
+    if (idx >= line.size() || !::isdigit((unsigned char)line[idx])) return false;
+    bit = 0;
+    while (idx < line.size() && ::isdigit((unsigned char)line[idx]))
+        bit = bit*10 + (line[idx++] - '0');
+
+    // '=' or '-' separator
+    skipSpaces();
+    if (idx >= line.size() || (line[idx] != '=' && line[idx] != '-')) return false;
+    idx++;
+
+    // the rest (trimmed) is the name
+    skipSpaces();
+    size_t end = line.size();
+    while (end > idx && ::isspace((unsigned char)line[end-1])) end--;
+    if (end == idx) return false;
+
+    name = line.substr(idx, end - idx);
+    return true;
 }
 
 std::string MessageField::typeToString(PacketItem_t typeEnum)
@@ -83,11 +203,12 @@ std::string MessageField::typeToString(PacketItem_t typeEnum)
         case bytes:       return std::string("bytes"        ); break;
         case words:       return std::string("words"        ); break;
         case long_long:   return std::string("long long"    ); break;
+        case signedByte:  return std::string("signed byte"  ); break;
         default:          return std::string("UNKNOWN"      ); break;
         }
 }
 
-MessageField::PacketItem_t MessageField::stringToType(std::string type)
+MessageField::PacketItem_t MessageField::stringToType(std::string_view type)
 {
     if      (type == "bitfield")    { return bitfield; }
     else if (type == "byte")        { return byte; }
@@ -98,16 +219,18 @@ MessageField::PacketItem_t MessageField::stringToType(std::string type)
     else if (type == "bytes")       { return bytes; }
     else if (type == "words")       { return words; }
     else if (type == "long long")   { return long_long; }
+    else if (type == "signed byte") { return signedByte; }
     else                            { return none; }
 }
 
-void MessageField::printMsgField()
+void MessageField::printMsgField(const BYTE* data) const
 {
     std::cout << m_name << " " << m_type << " " << m_size << '\n' ;
-    for (std::string& detail : m_details) std::cout << detail << '\n';
-    for (BYTE& byte : m_data)             std::cout << std::uppercase << std::setw(2) << 
-                                            std::setfill('0') << std::hex << (int)(byte) << ", ";
-    std::cout << std::dec;
+    for (std::string_view detail : getDetails()) std::cout << detail << '\n';
+    if (data)
+    {
+        for (int i = m_offset; i < m_offset + m_size; i++) std::cout.write(hexPair(data[i]), 2) << ", ";
+    }
     std::cout << '\n';
 
 }
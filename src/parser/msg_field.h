@@ -9,11 +9,82 @@
 #include <vector>
 #include <sstream>
 #include <cstdint>
+#include <string_view>
+#include <variant>
+
+#include "schema_arena.h"
+#include "byte_order.h"
 
 typedef unsigned int uint;
-typedef uint8_t BYTE;
 
-std::vector<std::string> split(const std::string& str, const char& delimiter); // Helper, splits a string using delimiter                        
+std::vector<std::string> split(const std::string& str, const char& delimiter); // Helper, splits a string using delimiter
+
+// A named bit of a bitfield, parsed from its DataDetails (ex. "bit 0 = motor enabled")
+struct BitName
+{
+    std::string_view name;
+    int              bit;       // 0 is the LSB of the field
+};
+
+/**
+ * @brief Location of one or more bits of a bitfield inside a data buffer.
+ * Resolve it once with Message::getBitMask() and test it on every packet
+ * received afterwards, no string lookups or shifts involved.
+ */
+struct BitMask
+{
+    int  offset;    // byte index into the data buffer, -1 if not found
+    BYTE mask;
+
+    bool isValid()                  const { return offset >= 0 && mask != 0; }
+    bool test(const BYTE* data)     const { return (data[offset] & mask) != 0;    }   // any bit set
+    bool testAll(const BYTE* data)  const { return (data[offset] & mask) == mask; }   // every bit set
+
+    // Combines masks of the same byte, anything else yields an invalid mask
+    BitMask operator|(const BitMask& other) const
+    {
+        if (!isValid() || offset != other.offset) return {-1, 0};
+        return {offset, BYTE(mask | other.mask)};
+    }
+};
+
+// A `bytes` field, points inside the MessageInstance it was read from
+struct BytesView
+{
+    const BYTE* data;
+    int         size;
+};
+
+// A `words` field, points inside the MessageInstance it was read from and decodes on access
+struct WordsView
+{
+    const BYTE* data;
+    int         count;
+
+    uint16_t operator[](int idx)                const { return loadBigEndian<uint16_t>(data + idx*2); }
+    int      copyTo(uint16_t* out, int maxCount) const;   // bulk decode, @return words written
+};
+
+/*
+ * Value of any field, the alternative held follows the field's PacketItem_t:
+ *
+ * none         -> std::monostate       bitfield, byte  -> uint8_t
+ * signed byte  -> int8_t               word            -> uint16_t
+ * signed word  -> int16_t              long            -> uint32_t
+ * long long    -> uint64_t             string          -> std::string_view
+ * bytes        -> BytesView            words           -> WordsView
+ *
+ * Views point inside the MessageInstance, copy them out if the instance may change.
+ */
+typedef std::variant<std::monostate, uint8_t, int8_t, uint16_t, int16_t, uint32_t, uint64_t,
+                     std::string_view, BytesView, WordsView> FieldValue;
+
+// Printable form of a value (numbers in decimal, bytes/words in hex), for loggers and exporters
+std::string fieldValueToString(const FieldValue& value);
+
+// Integer alternatives widened to int64_t (unsigned 64 bit values above INT64_MAX wrap)
+// @return false for strings, bytes, words and none
+bool fieldValueToInt(const FieldValue& value, int64_t& out);
 
 /**
  * @brief The MessageField class contains all necessary parsing info for
@@ -21,20 +92,21 @@ std::vector<std::string> split(const std::string& str, const char& delimiter); /
  * single int, or a single byte. There are often multiple MessageDataItems
  * transmitted inside each packet.
  *
- * The MessageField class is the blueprint for each message item, holding data 
- * bytes inside `m_data`
- * 
- * This class holds the data info and actual bytes for a field. 
+ * The MessageField class is the blueprint (schema) for each message item. It is
+ * immutable once loaded and shared by every MessageInstance of its Message, the
+ * actual bytes live inside the MessageInstance's data buffer at `m_offset`.
+ * Its strings are interned inside the table's SchemaArena, except for the
+ * details which are kept once per process (see internDetails()).
+ *
  * ex. Consider MDB_Rpm_Command, an object of this class would be:
  * m_name: "rpm command"
- * m_type: word, m_size: 2 bytes, m_details: 100 - 7000 rpm, m_data: 0x0000 (as a byte array)
- * 
+ * m_type: word, m_size: 2 bytes, m_offset: 0, m_details: 100 - 7000 rpm
+ *
  */
 class MessageField
 {
     public:
-        MessageField(std::string name, std::string type, std::string size, std::string detail, std::vector<std::string> defaultData);
-        MessageField(std::string name, std::string type, std::string size, std::string detail);
+        MessageField(std::string_view name, std::string_view type, int size, std::string_view details, ArenaArray<const BitName> bits, int offset);
 
         enum PacketItem_t {
             none = 0,
@@ -47,39 +119,52 @@ class MessageField
             bytes,
             words,
             long_long,
+            signedByte,
             maxTypes
         };
 
+        // Decodes a field of `size` bytes starting at `field`, picked once per field when loading
+        typedef FieldValue (*Decoder)(const BYTE* field, int size);
+
         // Getters
-        std::string                 getName();
-        std::string                 getType();
-        PacketItem_t                getTypeEnum();
-        int                         getSize();
-        std::vector<std::string>    getDetails();
-        std::vector<BYTE>           getData();
-
-        // Setters
-        void setName(std::string name)                      {m_name = name;}
-        void setType(std::string type)                      {m_type = type;     m_typeEnum = stringToType(type); }
-        void setType(PacketItem_t type)                     {m_typeEnum = type; m_type = typeToString(type); }
-        void setSize(int size)                              {m_size = size;}
-        void setDetails(std::vector<std::string> details)   {m_details = details;}
-        void setData(std::vector<BYTE> data)                {m_data = data;}
+        std::string_view                    getName()       const { return m_name;     }
+        std::string_view                    getType()       const { return m_type;     }
+        PacketItem_t                        getTypeEnum()   const { return m_typeEnum; }
+        int                                 getSize()       const { return m_size;     }
+        int                                 getOffset()     const { return m_offset;   }   // byte index into the data buffer
+        std::string_view                    getDetailText() const { return m_details;  }   // raw DataDetails text
+
+        // Details split into lines, only done when asked for since it is only used for printing
+        std::vector<std::string_view>       getDetails()    const;
+
+        // Bitfields only: bits named in the details, see parseBitName()
+        ArenaArray<const BitName>           getBitNames()   const { return m_bits;     }
+        int                                 findBit(std::string_view bitName) const;   // case insensitive, -1 if not found
+        BitMask                             getBitMask(int bit) const;                 // invalid if `bit` is out of range
+
+        // Parses a details line such as "bit 3 = attained speed", "bit 0 - GPIO24" or "bit5 = T9"
+        // @return true if `line` names a bit
+        static bool parseBitName(std::string_view line, int& bit, std::string_view& name);
+
+        // Decodes this field out of `data` (a full data buffer) according to its type
+        FieldValue decode(const BYTE* data)     const { return m_decoder(data + m_offset, m_size); }
 
         static std::string typeToString(PacketItem_t typeEnum);
-        static PacketItem_t stringToType(std::string type);
+        static PacketItem_t stringToType(std::string_view type);
 
-        void printMsgField();
+        // Prints the schema, and the field's bytes inside `data` (a full data buffer) if given
+        void printMsgField(const BYTE* data = nullptr) const;
     private:
-        std::string                m_name;         // Human name of data item
-        std::string                m_type;         // Human readable string for type
-        PacketItem_t               m_typeEnum;     // enum version for type
-        int                        m_size;         // In bytes
-        std::vector<std::string>   m_details;      // Info about the data
-
-        std::vector<BYTE>          m_data;         // Actual data contents (if any)
-        // m_data[0] represents the byte closest to the header bytes.
-        // m_data[m_data.size()-1] represents the byte closest to checksum. 
+        const std::string_view                      m_name;         // Human name of data item
+        const std::string_view                      m_type;         // Human readable string for type
+        const PacketItem_t                          m_typeEnum;     // enum version for type
+        const int                                   m_size;         // In bytes
+        const int                                   m_offset;       // In bytes, from the first data byte (DATA_IDX)
+        const std::string_view                      m_details;      // Info about the data (newline separated)
+        const ArenaArray<const BitName>             m_bits;         // Named bits (bitfields only)
+        const Decoder                               m_decoder;      // Chosen from m_typeEnum and m_size
+
+        static Decoder selectDecoder(PacketItem_t type, int size);
 };
 
 #endif // MSG_FIELD_H
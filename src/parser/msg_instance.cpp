@@ -0,0 +1,381 @@
+#include "msg_instance.h"
+#include "../serial/lf_comm.h"
+#include "byte_order.h"
+
+#include <type_traits>
+
+MessageInstance::MessageInstance()
+    : m_schema(nullptr), m_sum(0)
+{
+    std::memset(m_data, 0, sizeof(m_data));
+}
+
+MessageInstance::MessageInstance(const Message* schema)
+{
+    bind(schema);
+}
+
+void MessageInstance::bind(const Message* schema)
+{
+    m_schema = schema;
+    m_sum    = m_schema ? m_schema->getDefaultSum() : 0;
+    std::memset(m_data, 0, sizeof(m_data));
+    if (m_schema)
+        std::memcpy(m_data, m_schema->getDefaultData(), m_schema->getDataSize());
+}
+
+bool MessageInstance::assign(const Message* schema, const BYTE* data, int size)
+{
+    if (!schema || size != (schema->getPackLen() - MIN_PACK_LEN)) {bind(schema); return false;}
+
+    m_schema = schema;
+
+    // Copy and checksum in the same pass
+    int  copied = std::min(size, schema->getDataSize());
+    BYTE sum    = schema->getHeaderSum();
+    for (int i = 0; i < copied; i++)
+    {
+        m_data[i] = data[i];
+        sum      += data[i];
+    }
+    std::memset(m_data + copied, 0, schema->getDataSize() - copied);
+    m_sum = sum;
+    return true;
+}
+
+comm_error MessageInstance::sendMessage(MessageInstance* response)
+{
+    if (!m_schema)
+    {
+        std::cout << "Cannot send an unbound message...";
+        return INVALID_MSG;
+    }
+    if (!m_schema->isOutgoing())
+    {
+        std::cout << m_schema->getMsgName() << " is NOT an outgoing message...";
+        return INVALID_MSG;
+    }
+
+    // The whole exchange, response decoded into `response` included, is one serial thread job:
+    // another caller can't reuse serialComm before this one is done with it
+    comm_error error;
+    if (serialThread.isRunning() && !serialThread.isCurrent()) serialThread.run([&]() { error = exchange(response); });
+    else                                                       error = exchange(response);
+
+    // The exchange is over and its response decoded, trigger callbacks may send now
+    triggers.dispatch();
+    return error;
+}
+
+comm_error MessageInstance::exchange(MessageInstance* response)
+{
+    // Opt-in (see ResponseCache): a fresh answer to the same query skips the bus
+    bool cacheable = responseCache.isEnabled(m_schema);
+    if (cacheable && responseCache.lookup(*this, response)) return NONE;
+
+    // Failed exchanges are sent again as the RetryPolicy of this command allows
+    uint32_t delayMs;
+    for (int attempt = 0; !sendPacket(this); attempt++)
+    {
+        comm_error error = serialComm.errorState;
+        std::cout << "ERROR: sendPacket() failed with error: " << error << '\n';
+        if (!commRetry.onFailure(m_schema, error, attempt, delayMs)) return error;
+
+        std::cout << "Retrying " << m_schema->getMsgName() << " (" << attempt + 1 << ") in " << delayMs << "ms\n";
+        usleep(delayMs * 1000);
+        commFlushInput();
+    }
+
+    if (!cacheable) return handleResponse(response);
+
+    MessageInstance local;
+    MessageInstance& received = response ? *response : local;
+    comm_error error = handleResponse(&received);
+    if (error == NONE) responseCache.store(*this, received);
+    return error;
+}
+
+std::vector<BYTE> MessageInstance::getDataBuffer() const
+{
+    return std::vector<BYTE>(m_data, m_data + getDataSize());
+}
+
+/* Algorithm for message checksum:
+*  Two's complement of the sum of the header and data bytes.
+*
+*  In other words, take the sum of all bytes in a packet (except the CS) and negate it.
+*  The sum (m_sum) starts from Message::getDefaultSum() and every write adds the
+*  difference of the bytes it changes, so encoding costs O(changed bytes).
+*/
+void MessageInstance::writeBytes(int offset, const BYTE* bytes, int size)
+{
+    BYTE* dst = m_data + offset;
+    for (int i = 0; i < size; i++)
+    {
+        m_sum  += BYTE(bytes[i] - dst[i]);
+        dst[i]  = bytes[i];
+    }
+}
+
+std::vector<BYTE> MessageInstance::getMessageBuffer() const
+{
+    std::vector<BYTE> message;
+    if (!m_schema) return message;
+
+    message.reserve(HEADER_LEN + getDataSize() + 1);
+
+    // Header bytes
+    message.insert(message.end(), m_schema->getHeader(), m_schema->getHeader() + HEADER_LEN);
+
+    // Data buffer
+    message.insert(message.end(), m_data, m_data + getDataSize());
+
+    // CS
+    message.push_back(getChecksum());
+
+    return message;
+}
+
+bool MessageInstance::setDataBuffer(const BYTE* newBuffer, int size)
+{
+    // Size mismatch: keep the current data
+    if (!m_schema || size != (m_schema->getPackLen() - MIN_PACK_LEN)) {return false;}
+
+    writeBytes(0, newBuffer, std::min(size, getDataSize()));
+    return true;
+}
+
+int MessageInstance::getWords(const std::string& dataName, uint16_t* out, int maxCount) const
+{
+    const MessageField *toRead = m_schema ? m_schema->findMessageField(dataName) : nullptr;
+    if (!toRead) return 0;
+
+    int count = std::min(toRead->getSize() / 2, maxCount);
+    decodeWords(m_data + toRead->getOffset(), out, count);
+    return count;
+}
+
+bool MessageInstance::setWords(const std::string& dataName, const uint16_t* in, int count)
+{
+    if (!m_schema || !m_schema->isEditable()) {std::cout << "ERROR: Message field '" <<  dataName << "' not editable..." << '\n'; return false;}
+
+    const MessageField *toModify = m_schema->findMessageField(dataName);
+    if (!toModify) return false;
+    if (count > toModify->getSize() / 2) {std::cout << "ERROR: " << count << " words do not fit in '" << dataName << "'..." << '\n'; return false;}
+
+    BYTE encoded[MAX_DATA_LEN];
+    encodeWords(in, encoded, count);
+    writeBytes(toModify->getOffset(), encoded, count * 2);
+    return true;
+}
+
+bool MessageInstance::getBit(const std::string& dataName, const std::string& bitName) const
+{
+    if (!m_schema) return false;
+    return testMask(m_schema->getBitMask(dataName, bitName));
+}
+
+bool MessageInstance::setBit(const BitMask& mask, bool value)
+{
+    if (!m_schema || !m_schema->isEditable()) {std::cout << "ERROR: Message bit not editable..." << '\n'; return false;}
+    if (!mask.isValid() || mask.offset >= getDataSize()) return false;
+
+    BYTE byte = value ? BYTE(m_data[mask.offset] | mask.mask) : BYTE(m_data[mask.offset] & ~mask.mask);
+    writeBytes(mask.offset, &byte, 1);
+    return true;
+}
+
+void MessageInstance::printMsg() const
+{
+    if (!m_schema) {std::cout << "(unbound message)\n"; return;}
+
+    std::cout << m_schema->getSearchTag() << " | " << m_schema->getTargetID() << m_schema->getSenderID() << m_schema->getMsgValue() << '\n';
+    std::cout << m_schema->getMsgName() << " PackLen: " << m_schema->getPackLen() << '\n';
+
+    for (const MessageField& piece : m_schema->getDataFormat())
+    {
+        piece.printMsgField(m_data);
+    }
+}
+
+FieldValue MessageInstance::getValue(const FieldHandle& handle) const
+{
+    if (!m_schema || handle.schema != m_schema) {std::cout << "ERROR: Field handle does not belong to this message..." << '\n'; return FieldValue();}
+
+    return m_schema->getDataFormat()[handle.index].decode(m_data);
+}
+
+// Field of this (editable) instance behind `handle`, nullptr and an ERROR message otherwise
+static const MessageField* editableField(const Message* schema, const FieldHandle& handle)
+{
+    if (!schema || handle.schema != schema) {std::cout << "ERROR: Field handle does not belong to this message..." << '\n'; return nullptr;}
+    if (!schema->isEditable()) {std::cout << "ERROR: Message " << schema->getMsgName() << " not editable..." << '\n'; return nullptr;}
+    return &schema->getDataFormat()[handle.index];
+}
+
+bool MessageInstance::setInt(const FieldHandle& handle, uint64_t value)
+{
+    const MessageField* field = editableField(m_schema, handle);
+    if (!field) return false;
+
+    switch (field->getTypeEnum())
+    {
+        case MessageField::bitfield:   case MessageField::byte:    case MessageField::signedByte:
+        case MessageField::word:       case MessageField::signedWord:
+        case MessageField::longInt:    case MessageField::long_long:
+            break;
+        default:
+            std::cout << "ERROR: Message field '" << field->getName() << "' is not an integer..." << '\n';
+            return false;
+    }
+
+    BYTE bytes[MAX_DATA_LEN];     // sizes come from the XML, bytes past the 8th are 0
+    int  size = field->getSize();
+    for (int i = size - 1; i >= 0; i--, value >>= 8)
+        bytes[i] = BYTE(value);
+
+    writeBytes(field->getOffset(), bytes, size);
+    return true;
+}
+
+bool MessageInstance::setText(const FieldHandle& handle, std::string_view text)
+{
+    const MessageField* field = editableField(m_schema, handle);
+    if (!field) return false;
+    if (field->getTypeEnum() != MessageField::string) {std::cout << "ERROR: Message field '" << field->getName() << "' is not a string..." << '\n'; return false;}
+
+    BYTE padded[MAX_DATA_LEN];
+    int  copied = std::min(int(text.size()), field->getSize());
+    std::memcpy(padded, text.data(), copied);
+    std::memset(padded + copied, 0, field->getSize() - copied);
+
+    writeBytes(field->getOffset(), padded, field->getSize());
+    return true;
+}
+
+template<typename T>
+T stitchIntBytes(const BYTE* bytes, int size)   // Helper function for stiching int based bytes
+{
+    // Fast path when the field matches the requested type, bytes above sizeof(T) are dropped otherwise
+    if (size == int(sizeof(T))) return T(loadBigEndian<typename std::make_unsigned<T>::type>(bytes));
+    return T(loadBigEndian(bytes, size));
+}
+
+// Finds `dataName` and checks its declared type is one of `accepted` (any type if empty)
+// @return NULL and prints ERROR message on failure
+static const MessageField* findTypedField(const Message* schema, const std::string& dataName,
+                                          std::initializer_list<MessageField::PacketItem_t> accepted, const char* requested)
+{
+    const MessageField *field = schema ? schema->findMessageField(dataName) : nullptr;
+    if (!field) return nullptr;
+
+    if (accepted.size() != 0 && std::find(accepted.begin(), accepted.end(), field->getTypeEnum()) == accepted.end())
+    {
+        std::cout << "ERROR: Message field '" << dataName << "' is a " << field->getType() << ", cannot be read as " << requested << "..." << '\n';
+        return nullptr;
+    }
+    return field;
+}
+
+// Template specializations for getField(std::string)
+template<> // bitfield byte, byte
+BYTE MessageInstance::getField<BYTE>(const std::string& dataName) const
+{
+    /* find the field */
+    const MessageField *toRead = findTypedField(m_schema, dataName, {MessageField::bitfield, MessageField::byte}, "BYTE");
+    if (!toRead) return BYTE();
+
+    /* stitch the bytes */
+    return m_data[toRead->getOffset()];
+}
+
+template<> // signed byte
+int8_t MessageInstance::getField<int8_t>(const std::string& dataName) const
+{
+    /* find the field */
+    const MessageField *toRead = findTypedField(m_schema, dataName, {MessageField::signedByte}, "SIGNED_BYTE");
+    if (!toRead) return int8_t();
+
+    /* stitch the bytes */
+    return int8_t(m_data[toRead->getOffset()]);
+}
+
+template<> // word
+uint16_t MessageInstance::getField<uint16_t>(const std::string& dataName) const
+{
+    /* find the field */
+    const MessageField *toRead = findTypedField(m_schema, dataName, {MessageField::word}, "WORD");
+    if (!toRead) return uint16_t();
+
+    /* stitch the bytes */
+    return stitchIntBytes<uint16_t>(m_data + toRead->getOffset(), toRead->getSize());
+}
+
+template<> // string
+std::string MessageInstance::getField<std::string>(const std::string& dataName) const
+{
+    /* find the field */
+    const MessageField *toRead = findTypedField(m_schema, dataName, {MessageField::string}, "STRING");
+    if (!toRead) return std::string();
+
+    /* stitch the bytes */
+    const BYTE* bytes = m_data + toRead->getOffset();
+    return std::string(bytes, bytes + toRead->getSize());
+}
+
+template<> // long
+uint32_t MessageInstance::getField<uint32_t>(const std::string& dataName) const
+{
+    /* find the field */
+    const MessageField *toRead = findTypedField(m_schema, dataName, {MessageField::longInt}, "LONG_INT");
+    if (!toRead) return uint32_t();
+
+    /* stitch the bytes */
+    return stitchIntBytes<uint32_t>(m_data + toRead->getOffset(), toRead->getSize());
+}
+
+template<> // signed word
+int16_t MessageInstance::getField<int16_t>(const std::string& dataName) const
+{
+    /* find the field */
+    const MessageField *toRead = findTypedField(m_schema, dataName, {MessageField::signedWord}, "SIGNED_WORD");
+    if (!toRead) return int16_t();
+
+    /* stitch the bytes */
+    return stitchIntBytes<int16_t>(m_data + toRead->getOffset(), toRead->getSize());
+}
+
+template<> // byteS (or the raw bytes of any field): points inside this instance, valid for as long as the instance is
+const BYTE* MessageInstance::getField<const BYTE*>(const std::string& dataName) const
+{
+    /* find the field */
+    const MessageField *toRead = findTypedField(m_schema, dataName, {}, "BYTES");
+    if (!toRead) return nullptr;
+
+    /* stitch the bytes */
+    return m_data + toRead->getOffset();
+}
+
+template<> // wordS: vector of uint16_t
+std::vector<uint16_t> MessageInstance::getField<std::vector<uint16_t>>(const std::string& dataName) const
+{
+    /* find the field */
+    const MessageField *toRead = findTypedField(m_schema, dataName, {MessageField::words}, "WORDS");
+    if (!toRead) return std::vector<uint16_t>();
+
+    /* stitch the bytes */
+    std::vector<uint16_t> result(toRead->getSize() / 2, 0);
+    decodeWords(m_data + toRead->getOffset(), result.data(), result.size());
+    return result;
+}
+
+template<> // long long
+uint64_t MessageInstance::getField<uint64_t>(const std::string& dataName) const
+{
+    /* find the field */
+    const MessageField *toRead = findTypedField(m_schema, dataName, {MessageField::long_long}, "LONG_LONG");
+    if (!toRead) return uint64_t();
+
+    /* stitch the bytes */
+    return stitchIntBytes<uint64_t>(m_data + toRead->getOffset(), toRead->getSize());
+}
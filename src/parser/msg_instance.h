@@ -0,0 +1,144 @@
+#ifndef MSG_INSTANCE_H
+#define MSG_INSTANCE_H
+
+#include "msg.h"
+
+/**
+ * @brief A MessageInstance holds the live bytes of one packet for a given
+ * Message schema. The schema (names, types, sizes, offsets) is shared and never
+ * modified, every command sent or report received gets its own instance.
+ *
+ * Instances are small fixed size objects (no heap allocations) so they can be
+ * declared on the stack or copied around. Only the schemas are safe to share:
+ * sendMessage() goes through the serial engine's globals (serialComm, the
+ * retry, cache, trigger, change and health state), which are not thread safe.
+ * One thread owns the bus: threads that send must take turns (as ./sequencer
+ * does with its bus lock).
+ *
+ *      MessageInstance cmd(table.findMessage("MDB_Rpm_Command"));
+ *      MessageInstance rsp;
+ *      cmd.setField("rpm command", WORD(1000));
+ *      cmd.sendMessage(&rsp);
+ *      WORD rpm = rsp.getField<WORD>("actual rpm");
+ *
+ * Generic code (loggers, exporters) can walk every field without knowing the types:
+ *
+ *      for (int i = 0; i < int(rsp.getSchema()->getDataFormat().size()); i++)
+ *          std::cout << fieldValueToString(rsp.getValue(rsp.getSchema()->getFieldHandle(i))) << '\n';
+ *
+ * Bits of a bitfield are best resolved once and then tested on every report:
+ *
+ *      BitMask stopped = table.findMessage("Push_Report")->getBitMask("status0", "motor stopped");
+ *      while (!rsp.testMask(stopped)) cmd.sendMessage(&rsp);
+ */
+
+class MessageInstance
+{
+    public:
+        MessageInstance();                                  // unbound, see bind()
+        explicit MessageInstance(const Message* schema);    // data starts as the schema's DefaultData
+
+        // Points this instance to a schema and resets its data to the schema's defaults
+        void bind(const Message* schema);
+
+        // Points this instance to a schema and copies in the data bytes of a received packet in one
+        // pass (no defaults written first). Fields are decoded straight from these bytes when read.
+        // @return false if `size` doesn't match the schema's PackLen (data is then the defaults)
+        bool assign(const Message* schema, const BYTE* data, int size);
+
+        // Object-based function for sending a message
+        // `response` (if not NULL) is bound to and filled with the received report
+        // @return a type of error, see serial/comm_errors.h, usually 0 on success
+        comm_error sendMessage(MessageInstance* response = nullptr);
+
+        // Getters
+        const Message*    getSchema()   const { return m_schema; }
+        bool              isBound()     const { return m_schema != nullptr; }
+        const BYTE*       getData()     const { return m_data; }
+        int               getDataSize() const { return m_schema ? m_schema->getDataSize() : 0; }
+
+        std::vector<BYTE> getDataBuffer()       const;      // data bytes
+        BYTE              getChecksum()         const { return BYTE(-m_sum); }    // kept up to date by every write, nothing to add up
+        std::vector<BYTE> getMessageBuffer()    const;      // includes all bytes within the message
+
+        // Copies in the data bytes of a received packet, `size` must match the schema's PackLen
+        // @return false on size mismatch (data is left unchanged)
+        bool setDataBuffer(const BYTE* newBuffer, int size);
+        bool setDataBuffer(const std::vector<BYTE>& newBuffer) { return setDataBuffer(newBuffer.data(), int(newBuffer.size())); }
+
+        /**
+         * Sets the value of a field identified by `dataName` to the value provided in `input`.
+         * The field type `T` is later casted to the type of DataName with the use of helper functions.
+         *
+         * @tparam T The type of the input value.
+         * @param dataName The identifier of the data field to be set.
+         * @param input The value to set for the data field.
+         * @return true if the field was successfully set, false otherwise.
+         */
+        template <typename T>
+        bool setField(const std::string& dataName, const T& input);
+
+        // Reads a field as T, T has to match the field's type (see checkFieldType() in the .cpp)
+        // otherwise an ERROR message is printed and T() returned
+        template <typename T>
+        T getField(const std::string& dataName) const;
+
+        // Reads any field as the type declared in the XML (see FieldValue), the handle
+        // must come from this instance's schema. Decoding is a single indirect call.
+        FieldValue getValue(const FieldHandle& handle) const;
+        FieldValue getValue(const std::string& dataName) const { return m_schema ? getValue(m_schema->getFieldHandle(dataName)) : FieldValue(); }
+
+        // Handle based counterparts of setField(), no name lookup, outgoing messages only.
+        // Integer fields take the low getSize() bytes of `value` (big endian in the packet),
+        // string fields the characters of `text`, zero padded and truncated to the field size.
+        bool setInt (const FieldHandle& handle, uint64_t value);
+        bool setText(const FieldHandle& handle, std::string_view text);
+
+        // `words` fields: decodes up to `maxCount` words into `out` without any allocation
+        // @return the number of words written
+        int  getWords(const std::string& dataName, uint16_t* out, int maxCount) const;
+        // Encodes `count` words at the start of the field, outgoing messages only
+        bool setWords(const std::string& dataName, const uint16_t* in, int count);
+
+        // Bitfields: masks come from Message::getBitMask(), testing them is a single AND
+        bool testMask(const BitMask& mask)      const { return mask.isValid() && mask.test(m_data);    }   // any bit set
+        bool testAllMask(const BitMask& mask)   const { return mask.isValid() && mask.testAll(m_data); }   // every bit set
+        bool getBit(const std::string& dataName, const std::string& bitName) const;                        // resolves the mask each call
+        bool setBit(const BitMask& mask, bool value);                                                      // outgoing messages only
+
+        void printMsg() const;
+    private:
+        // Copies `size` bytes to m_data[offset] and updates m_sum with the difference of each byte
+        void writeBytes(int offset, const BYTE* bytes, int size);
+
+        // sendMessage() without the checks: cache, send with retries, decode into `response`.
+        // Uses the serial engine's globals, so it runs on the serial thread when there is one
+        comm_error exchange(MessageInstance* response);
+
+        const Message* m_schema;
+        BYTE           m_sum;                   // header and data bytes added up (mod 256), the checksum is its negation
+        BYTE           m_data[MAX_DATA_LEN];    // m_data[0] is the byte closest to the header bytes
+};
+
+template <typename T>
+bool MessageInstance::setField(const std::string& dataName, const T& input) // linker does not want this to be defined anywhere else...
+{
+    if (!m_schema) {std::cout << "ERROR: Message field '" << dataName << "' set on an unbound message..." << '\n'; return false;}
+    if (!m_schema->isEditable()) {std::cout << "ERROR: Message field '" <<  dataName << "' not editable..." << '\n'; return false;}
+
+    /* find the relevant MessageField */
+    const MessageField *toModify = m_schema->findMessageField(dataName);
+    if (!toModify) {return false;}
+
+    /* modify the data */
+    std::vector<BYTE> newBytes;
+
+    // `string` and `bytes` types have to be flipped to match correct bit ordering
+    if (toModify->getTypeEnum() == MessageField::string || toModify->getTypeEnum() == MessageField::bytes) newBytes = fetchBytes(input, toModify->getSize(), true);
+    else newBytes = fetchBytes(input, toModify->getSize(), false);
+
+    writeBytes(toModify->getOffset(), newBytes.data(), int(newBytes.size()));
+    return true;
+}
+
+#endif // MSG_INSTANCE_H
@@ -10,6 +10,9 @@
  */
 void MessageTable::addMessage(std::string& searchTag, Message* msg)
 {
+    uint64_t key;
+    if (tagToKey(searchTag, key)) m_headerIndex[key] = msg;
+
     if (findMessageByTag(searchTag) != nullptr)
     {
         std::cout << "Message " << searchTag << " already exists, overwriting!";
@@ -21,6 +24,9 @@ void MessageTable::addMessage(std::string& searchTag, Message* msg)
 
 void MessageTable::removeMessage(std::string &searchTag)
 {
+    uint64_t key;
+    if (tagToKey(searchTag, key)) m_headerIndex.erase(key);
+
     m_msgTable.erase(m_msgTable.find(searchTag));
 }
 
@@ -30,6 +36,13 @@ void MessageTable::updateMessage(std::string &searchTag, Message *msg)
     addMessage(searchTag, msg);
 }
 
+void MessageTable::clear()
+{
+    m_msgTable.clear();
+    m_headerIndex.clear();
+    m_arena.clear();
+}
+
 
 // GETTERS =============================================================================
 
@@ -39,11 +52,12 @@ void MessageTable::updateMessage(std::string &searchTag, Message *msg)
  * @param searchTag
  * @return Message pointer, or null on failure
  */
-Message* MessageTable::findMessageByTag(std::string& searchTag)
+const Message* MessageTable::findMessageByTag(const std::string& searchTag) const
 {
-    if (m_msgTable.find(searchTag) != m_msgTable.end())
+    std::map<std::string, Message*>::const_iterator itr = m_msgTable.find(searchTag);
+    if (itr != m_msgTable.end())
     {
-        return m_msgTable.at(searchTag);
+        return itr->second;
     }
     else
     {
@@ -52,25 +66,72 @@ Message* MessageTable::findMessageByTag(std::string& searchTag)
 }
 
 /**
- * @brief MessageTable::findMessage
+ * @brief MessageTable::findMessageByHeader
+ * Look up for received packets, done on every response so it avoids building strings
+ * @param header TARGET ID, LENGTH, SEQUENCE, SENDER ID, MSG CODE
+ * @return Message pointer, or null on failure
+ */
+const Message* MessageTable::findMessageByHeader(const BYTE* header) const
+{
+    std::unordered_map<uint64_t, Message*>::const_iterator itr = m_headerIndex.find(headerKey(header[0], header[3], header[4]));
+    if (itr != m_headerIndex.end()) return itr->second;
+
+    itr = m_headerIndex.find(headerKey(header[0], header[3], header[4], header[1]));
+    if (itr != m_headerIndex.end()) return itr->second;
+
+    return nullptr;
+}
+
+bool MessageTable::tagToKey(const std::string& searchTag, uint64_t& key)
+{
+    std::vector<std::string> ids = split(searchTag, ':');
+    if (ids.size() != 3 && ids.size() != 4) return false;
+
+    BYTE bytes[4];
+    for (size_t i = 0; i < ids.size(); i++)
+    {
+        if (ids[i].empty() || ids[i].size() > 2 || !std::all_of(ids[i].begin(), ids[i].end(), ::isxdigit)) return false;
+        bytes[i] = static_cast<BYTE>(std::stoi(ids[i], nullptr, 16));
+    }
+
+    key = (ids.size() == 3) ? headerKey(bytes[0], bytes[1], bytes[2]) : headerKey(bytes[0], bytes[1], bytes[2], bytes[3]);
+    return true;
+}
+
+/**
+ * @brief MessageTable::lookupMessage
  * Will search for message by name, this is slower than search tag
  * Case insensitive
  * @param name
- * @return Message pointer, or null on failure
+ * @return Message pointer, or null if not found
  */
-Message *MessageTable::findMessage(const std::string &name)
+const Message *MessageTable::lookupMessage(const std::string &name) const
 {
     std::string lowerCaseName = name;
     std::transform(lowerCaseName.begin(), lowerCaseName.end(), lowerCaseName.begin(), ::tolower);
-    for (std::map<std::string, Message*>::iterator itr = m_msgTable.begin();
+    for (std::map<std::string, Message*>::const_iterator itr = m_msgTable.begin();
          itr != m_msgTable.end();
          itr++)
     {
-        std::string itrName = itr->second->getMsgName();
+        std::string itrName(itr->second->getMsgName());
         std::transform(itrName.begin(), itrName.end(), itrName.begin(), ::tolower);
         if (itrName == lowerCaseName)
             return itr->second;
     }
+    return nullptr;
+}
+
+/**
+ * @brief MessageTable::findMessage
+ * Same as lookupMessage(), for messages the program can't run without
+ * @param name
+ * @return Message pointer, exits if not found
+ */
+const Message *MessageTable::findMessage(const std::string &name) const
+{
+    const Message* msg = lookupMessage(name);
+    if (msg) return msg;
+
     std::cout << "ERROR: Message '" <<  name << "' not found..." << '\n';
     exit(1);
     return nullptr;
@@ -82,7 +143,7 @@ Message *MessageTable::findMessage(const std::string &name)
  * @param senderID, targetID, cmdID, length
  * @return search tag as formatted string
  */
-std::string MessageTable::generateSearchTag(std::string& senderID, std::string& targetID, std::string& cmdID, std::string& length)
+std::string MessageTable::generateSearchTag(std::string& senderID, std::string& targetID, std::string& cmdID, std::string& length) const
 {
     std::string searchTag = targetID + ":" + senderID + ":" + cmdID;
     if (cmdID == "1E")
@@ -98,22 +159,22 @@ std::string MessageTable::generateSearchTag(std::string& senderID, std::string&
     return searchTag;
 }
 
-std::vector<std::string> MessageTable::getMessageNames()
+std::vector<std::string> MessageTable::getMessageNames() const
 {
     std::vector<std::string> names;
-    for (std::map<std::string, Message*>::iterator itr = m_msgTable.begin();
+    for (std::map<std::string, Message*>::const_iterator itr = m_msgTable.begin();
          itr != m_msgTable.end();
          itr++)
     {
-        names.push_back(itr->second->getMsgName());
+        names.push_back(std::string(itr->second->getMsgName()));
     }
     return names;
 }
 
-std::vector<std::string> MessageTable::getMessageTags()
+std::vector<std::string> MessageTable::getMessageTags() const
 {
     std::vector<std::string> tags;
-    for (std::map<std::string, Message*>::iterator itr = m_msgTable.begin();
+    for (std::map<std::string, Message*>::const_iterator itr = m_msgTable.begin();
          itr != m_msgTable.end();
          itr++)
     {
@@ -126,12 +187,12 @@ std::vector<std::string> MessageTable::getMessageTags()
  * @brief MessageTable::empty
  * @return True if table is empty
  */
-bool MessageTable::empty()
+bool MessageTable::empty() const
 {
     return m_msgTable.empty();
 }
 
-void MessageTable::printTable()
+void MessageTable::printTable() const
 {
     for (auto const& pair : m_msgTable)
     {
@@ -2,33 +2,62 @@
 #define MSG_TABLE_H
 
 #include <map>
+#include <unordered_map>
 
-#include "msg.h"
+#include "msg_instance.h"
 
 /**
  * @brief The MessageTable class (Look Up Table)
+ *
+ * The table is filled once by loadDocument() and only read afterwards. Every
+ * getter is const and hands out const Message schemas, so any number of threads
+ * may look up messages concurrently without locking. Per-use data lives in a
+ * MessageInstance (see msg_instance.h). That covers lookups only: sending still
+ * goes through the serial engine's globals, which have a single owner.
+ *
+ * All Message schemas of the table live in its SchemaArena and are released
+ * together when the table is cleared or destroyed.
  */
 
 class MessageTable
 {
     public:
+        MessageTable() {}
+        MessageTable(const MessageTable&)            = delete;   // the arena can't be shared
+        MessageTable& operator=(const MessageTable&) = delete;
+
         // Setters
         void addMessage(std::string& searchTag, Message* msg); //recursive
         void removeMessage(std::string& searchTag);
         void updateMessage(std::string& searchTag, Message* msg);
+        void clear();   // removes every message and frees the arena
+
+        SchemaArena& getArena() {return m_arena;}   // where messages added to this table should be created
 
         // Getters
-        std::map<std::string, Message*> getMsgTable() {return m_msgTable;}
-        Message* findMessageByTag(std::string& searchTag);
-        Message* findMessage(const std::string& name);
-        std::string generateSearchTag(std::string &senderID, std::string &targetID, std::string &cmdID, std::string &length);
-        std::vector<std::string> getMessageNames();
-        std::vector<std::string> getMessageTags();
-        bool empty();
-
-        void printTable();
+        const std::map<std::string, Message*>& getMsgTable() const {return m_msgTable;}
+        const Message* findMessageByTag(const std::string& searchTag) const;
+        // Finds the schema of a received packet straight from its first HEADER_LEN bytes, without
+        // formatting a search tag. Same order as handleResponse() always used: "TT:SS:MM" first,
+        // then "TT:SS:MM:LL" (ex. Push Report). NULL if not found
+        const Message* findMessageByHeader(const BYTE* header) const;
+        const Message* findMessage(const std::string& name) const;     // exits if not found
+        const Message* lookupMessage(const std::string& name) const;   // NULL if not found
+        std::string generateSearchTag(std::string &senderID, std::string &targetID, std::string &cmdID, std::string &length) const;
+        std::vector<std::string> getMessageNames() const;
+        std::vector<std::string> getMessageTags() const;
+        bool empty() const;
+
+        void printTable() const;
     private:
         std::map<std::string, Message*> m_msgTable; // maps searchTags (ex. "11:F0:0D") to Message structures (ex. Version_Command (LS))
+        std::unordered_map<uint64_t, Message*> m_headerIndex;  // same entries keyed by tagToKey()
+        SchemaArena                     m_arena;    // owns every Message, MessageField and string of the table
+
+        // Packs a search tag's bytes into an integer key, false if `searchTag` isn't made of hex bytes
+        static bool tagToKey(const std::string& searchTag, uint64_t& key);
+        static uint64_t headerKey(BYTE target, BYTE sender, BYTE msgCode)               { return (uint64_t(target) << 24) | (uint64_t(sender) << 16) | (uint64_t(msgCode) << 8); }
+        static uint64_t headerKey(BYTE target, BYTE sender, BYTE msgCode, BYTE length)  { return headerKey(target, sender, msgCode) | length | (uint64_t(1) << 32); }
 };
 
 extern MessageTable table;
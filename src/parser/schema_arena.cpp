@@ -0,0 +1,101 @@
+#include "schema_arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+SchemaArena::SchemaArena()
+    : m_offset(0), m_used(0), m_capacity(0)
+{
+}
+
+SchemaArena::~SchemaArena()
+{
+    clear();
+}
+
+void SchemaArena::reserve(size_t bytes)
+{
+    if (!m_blocks.empty() && m_blocks.back().size - m_offset >= bytes) return;
+
+    size_t blockSize = std::max(bytes, MIN_BLOCK_SIZE);
+    m_blocks.push_back({new char[blockSize], blockSize});
+    m_offset    = 0;
+    m_capacity += blockSize;
+}
+
+void* SchemaArena::allocate(size_t bytes, size_t align)
+{
+    if (bytes == 0) bytes = 1;     // every allocation gets a unique address
+
+    // Align relative to the actual address, blocks come from new[] (max_align_t aligned)
+    size_t padding = 0;
+    if (!m_blocks.empty())
+    {
+        uintptr_t next = reinterpret_cast<uintptr_t>(m_blocks.back().data + m_offset);
+        padding = (align - (next % align)) % align;
+    }
+
+    // Out of room: grow geometrically so small tables still end up in few blocks
+    if (m_blocks.empty() || m_blocks.back().size - m_offset < padding + bytes)
+    {
+        reserve(std::max(bytes + align, m_capacity));
+        padding = 0;
+    }
+
+    void* ptr = m_blocks.back().data + m_offset + padding;
+    m_offset += padding + bytes;
+    m_used   += bytes;
+    return ptr;
+}
+
+void SchemaArena::clear()
+{
+    for (Block& block : m_blocks)
+        delete[] block.data;
+
+    m_blocks.clear();
+    m_offset   = 0;
+    m_used     = 0;
+    m_capacity = 0;
+}
+
+std::string_view StringPool::intern(std::string_view str)
+{
+    std::unordered_set<std::string_view>::const_iterator itr = m_index.find(str);
+    if (itr != m_index.end()) return *itr;
+
+    char* storage = static_cast<char*>(m_arena.allocate(str.size(), 1));
+    std::memcpy(storage, str.data(), str.size());
+
+    std::string_view interned(storage, str.size());
+    m_index.insert(interned);
+    return interned;
+}
+
+// Function-local statics so the pool is ready no matter which global is constructed first
+static SchemaArena& detailArena()
+{
+    static SchemaArena arena;
+    return arena;
+}
+
+static StringPool& detailPool()
+{
+    static StringPool pool(detailArena());
+    return pool;
+}
+
+static std::mutex detailMutex;
+
+std::string_view internDetails(std::string_view text)
+{
+    std::lock_guard<std::mutex> lock(detailMutex);
+    return detailPool().intern(text);
+}
+
+size_t getDetailPoolSize()
+{
+    std::lock_guard<std::mutex> lock(detailMutex);
+    return detailArena().getUsed();
+}
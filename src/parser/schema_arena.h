@@ -0,0 +1,118 @@
+#ifndef SCHEMA_ARENA_H
+#define SCHEMA_ARENA_H
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief View over a contiguous array that lives inside a SchemaArena.
+ * Does not own its elements, the arena does.
+ */
+template <typename T>
+class ArenaArray
+{
+    public:
+        ArenaArray()                        : m_data(nullptr), m_size(0) {}
+        ArenaArray(T* data, size_t size)    : m_data(data), m_size(size) {}
+
+        T*      begin()                 const { return m_data;          }
+        T*      end()                   const { return m_data + m_size; }
+        T&      operator[](size_t idx)  const { return m_data[idx];     }
+        size_t  size()                  const { return m_size;          }
+        bool    empty()                 const { return m_size == 0;     }
+    private:
+        T*      m_data;
+        size_t  m_size;
+};
+
+/**
+ * @brief The SchemaArena is a bump allocator that owns every schema object
+ * (Message, MessageField, interned strings, default data) of one loaded XML.
+ *
+ * loadDocument() measures the document first and reserve()s the whole table in a
+ * single block, objects are then carved out of it back to back. Nothing is freed
+ * individually: the blocks are released all at once by clear() or the destructor.
+ * Because of that only trivially destructible objects may be created inside.
+ */
+class SchemaArena
+{
+    public:
+        SchemaArena();
+        ~SchemaArena();
+
+        SchemaArena(const SchemaArena&)            = delete;
+        SchemaArena& operator=(const SchemaArena&) = delete;
+
+        // Makes sure the next `bytes` bytes can be allocated without another block
+        void    reserve(size_t bytes);
+        void*   allocate(size_t bytes, size_t align);
+        void    clear();    // frees every block, all pointers handed out become invalid
+
+        size_t  getUsed()       const { return m_used;          }   // in bytes
+        size_t  getCapacity()   const { return m_capacity;      }   // in bytes
+        size_t  getBlockCount() const { return m_blocks.size(); }
+
+        template <typename T, typename... Args>
+        T* create(Args&&... args)
+        {
+            static_assert(std::is_trivially_destructible<T>::value, "SchemaArena never runs destructors");
+            return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        // Uninitialized storage for `count` objects, construct them with placement new
+        template <typename T>
+        T* allocateArray(size_t count)
+        {
+            static_assert(std::is_trivially_destructible<T>::value, "SchemaArena never runs destructors");
+            return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        }
+    private:
+        struct Block
+        {
+            char*   data;
+            size_t  size;
+        };
+
+        std::vector<Block>  m_blocks;
+        size_t              m_offset;       // next free byte in the last block
+        size_t              m_used;
+        size_t              m_capacity;
+
+        static constexpr size_t MIN_BLOCK_SIZE = 4096;
+};
+
+/**
+ * @brief The StringPool interns strings into a SchemaArena so every distinct
+ * name, type or detail line is stored exactly once. The returned views stay
+ * valid for as long as the arena holds its blocks.
+ */
+class StringPool
+{
+    public:
+        explicit StringPool(SchemaArena& arena) : m_arena(arena) {}
+
+        std::string_view intern(std::string_view str);
+        size_t           size() const { return m_index.size(); }   // number of distinct strings
+    private:
+        SchemaArena&                            m_arena;
+        std::unordered_set<std::string_view>    m_index;
+};
+
+/*
+ * Interns `text` into the process wide detail pool and returns the stored copy.
+ * DataDetails blocks repeat across the base XMLs (TM, TMInt and their _TE variants),
+ * so every table loaded into the process shares one copy of each block. The pool
+ * is never freed, the views stay valid after their table is cleared. Thread safe.
+ */
+std::string_view internDetails(std::string_view text);
+
+// Bytes currently held by the detail pool
+size_t getDetailPoolSize();
+
+#endif // SCHEMA_ARENA_H
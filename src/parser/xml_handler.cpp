@@ -9,11 +9,20 @@ bool loadDocument(std::string& fileLocation, MessageTable& tableIn)
     xml_document doc;
     if (!doc.load_file(xmlDirectory.c_str())) {std::cout << "ERROR: '" << xmlDirectory << "' failed to load!\n"; return false;}
 
+    // Size the whole table up front so the arena needs a single allocation
+    size_t arenaSize = 0;
+    for (xml_node command : doc.child("NewDataSet").children("Commands"))
+        arenaSize += Message::arenaSizeHint(command);
+
+    SchemaArena& arena = tableIn.getArena();
+    arena.reserve(arenaSize);
+    StringPool strings(arena);  // only needed while loading, the interned strings stay in the arena
+
     for (xml_node command : doc.child("NewDataSet").children("Commands"))
     {
         std::string tag = std::string(command.child("SearchTag").child_value());
         std::transform(tag.begin(), tag.end(), tag.begin(), ::toupper);
-        tableIn.addMessage(tag, new Message(command));
+        tableIn.addMessage(tag, arena.create<Message>(command, arena, strings));
     }
     return true;
 }
\ No newline at end of file
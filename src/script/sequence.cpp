@@ -0,0 +1,477 @@
+#include "sequence.h"
+
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+// One exchange at a time on the serial port, shared by every running sequence
+static std::mutex busMutex;
+// Keeps the lines printed by concurrent sequences whole
+static std::mutex printMutex;
+
+/* Parsing ===================================================================================== */
+
+struct Token
+{
+    std::string text;
+    bool        quoted;
+};
+
+// Splits a line into words and "quoted strings", drops # comments
+// @return false on an unterminated quote
+static bool tokenize(const std::string& line, std::vector<Token>& tokens)
+{
+    tokens.clear();
+
+    size_t i = 0;
+    while (i < line.size())
+    {
+        if (isspace(static_cast<unsigned char>(line[i]))) {i++; continue;}
+        if (line[i] == '#') break;
+
+        if (line[i] == '"')
+        {
+            size_t close = line.find('"', i + 1);
+            if (close == std::string::npos) return false;
+            tokens.push_back({line.substr(i + 1, close - i - 1), true});
+            i = close + 1;
+        }
+        else
+        {
+            size_t end = i;
+            while (end < line.size() && !isspace(static_cast<unsigned char>(line[end])) && line[end] != '#') end++;
+            tokens.push_back({line.substr(i, end - i), false});
+            i = end;
+        }
+    }
+    return true;
+}
+
+// Decimal, 0x hex or negative integer
+static bool parseInt(const Token& token, int64_t& out)
+{
+    if (token.quoted || token.text.empty()) return false;
+
+    try
+    {
+        size_t used = 0;
+        out = std::stoll(token.text, &used, 0);
+        return used == token.text.size();
+    }
+    catch (const std::exception&) {return false;}
+}
+
+static bool isInteger(const MessageField& field)
+{
+    switch (field.getTypeEnum())
+    {
+        case MessageField::bitfield:   case MessageField::byte:    case MessageField::signedByte:
+        case MessageField::word:       case MessageField::signedWord:
+        case MessageField::longInt:    case MessageField::long_long:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* Compiling =================================================================================== */
+
+bool Sequence::load(const std::string& path, const MessageTable& table)
+{
+    std::ifstream file(path);
+    if (!file) {std::cout << "ERROR: Could not open '" << path << "'\n"; return false;}
+
+    std::stringstream source;
+    source << file.rdbuf();
+    return compile(source.str(), table, path);
+}
+
+bool Sequence::compile(const std::string& source, const MessageTable& table, const std::string& name)
+{
+    enum BlockKind { IF, ELSE, REPEAT_BLOCK, LOOP, WHILE };
+    struct Block
+    {
+        BlockKind        kind;
+        int              line;
+        int              start;     // first op of the body (loops), or the op to patch (if/else/while)
+        int              patch;
+        std::vector<int> breaks;
+    };
+
+    m_name = name;
+    m_msgNames.clear();
+    m_msgs.clear();
+    m_ops.clear();
+    m_counters = 0;
+
+    std::vector<Block> blocks;
+    std::vector<Token> tokens;
+    std::stringstream  lines(source);
+    std::string        text;
+    int                lineNumber = 0;
+    bool               ok = true;
+
+    // Prints a compile error, evaluates to false
+    auto error = [&](const std::string& what) { std::cout << "ERROR: " << m_name << ":" << lineNumber << ": " << what << '\n'; ok = false; return false; };
+
+    auto findMsg = [&](const Token& token) -> int {
+        for (int i = 0; i < int(m_msgNames.size()); i++)
+            if (m_msgNames[i] == token.text) return i;
+        error("unknown message '" + token.text + "', declare it with `msg " + token.text + " <Message name>`");
+        return -1;
+    };
+
+    // A message declared with a schema, for statements accessing its fields
+    auto findBoundMsg = [&](const Token& token) -> int {
+        int msg = findMsg(token);
+        if (msg >= 0 && !m_msgs[msg].isBound()) {error("'" + token.text + "' has no message type, declare it with `msg " + token.text + " <Message name>`"); return -1;}
+        return msg;
+    };
+
+    auto findField = [&](int msg, const Token& token) -> FieldHandle {
+        if (!token.quoted) {error("field names go between quotes: \"" + token.text + "\""); return {nullptr, -1};}
+        FieldHandle field = m_msgs[msg].getSchema()->getFieldHandle(token.text);
+        if (!field.isValid()) error("no field \"" + token.text + "\" in " + std::string(m_msgs[msg].getSchema()->getMsgName()));
+        return field;
+    };
+
+    auto findBit = [&](int msg, const Token& fieldToken, const Token& bitToken) -> BitMask {
+        const Message* schema = m_msgs[msg].getSchema();
+        int64_t bit;
+        BitMask mask = parseInt(bitToken, bit) ? schema->getBitMask(fieldToken.text, int(bit))
+                                               : schema->getBitMask(fieldToken.text, bitToken.text);
+        if (!mask.isValid()) error("no bit '" + bitToken.text + "' in \"" + fieldToken.text + "\"");
+        return mask;
+    };
+
+    // <msg> "<field>" <op> <integer>  |  <msg> "<field>" bit "<bit name>", optionally preceded by `not`
+    auto parseCondition = [&](size_t first, Condition& condition) -> bool {
+        if (first < tokens.size() && !tokens[first].quoted && tokens[first].text == "not") {condition.negate = true; first++;}
+        if (tokens.size() - first != 4) return error("expected a condition: <msg> \"<field>\" <op> <integer> or <msg> \"<field>\" bit \"<bit name>\"");
+
+        condition.msg = findBoundMsg(tokens[first]);
+        if (condition.msg < 0) return false;
+
+        const Token& op = tokens[first + 2];
+        if (op.text == "bit")
+        {
+            condition.compare = BIT;
+            condition.mask    = findBit(condition.msg, tokens[first + 1], tokens[first + 3]);
+            return condition.mask.isValid();
+        }
+
+        static const struct { const char* text; Compare compare; } compares[] = {
+            {"==", EQ}, {"!=", NE}, {"<", LT}, {"<=", LE}, {">", GT}, {">=", GE}
+        };
+        bool found = false;
+        for (const auto& entry : compares)
+            if (op.text == entry.text) {condition.compare = entry.compare; found = true;}
+        if (!found) return error("unknown comparison '" + op.text + "'");
+
+        condition.field = findField(condition.msg, tokens[first + 1]);
+        if (!condition.field.isValid()) return false;
+        if (!isInteger(condition.field.schema->getDataFormat()[condition.field.index])) return error("\"" + tokens[first + 1].text + "\" is not an integer field");
+        if (!parseInt(tokens[first + 3], condition.value)) return error("expected an integer, got '" + tokens[first + 3].text + "'");
+        return true;
+    };
+
+    auto emit = [&](OpCode code) -> Op& {
+        m_ops.push_back(Op{code, lineNumber});
+        return m_ops.back();
+    };
+
+    while (std::getline(lines, text))
+    {
+        lineNumber++;
+        if (!tokenize(text, tokens)) {error("missing closing quote"); continue;}
+        if (tokens.empty()) continue;
+
+        const std::string& keyword = tokens[0].text;
+        size_t             count   = tokens.size();
+
+        if (keyword == "msg")
+        {
+            if (count < 2 || count > 3 || tokens[1].quoted) {error("expected `msg <name> [<Message name>]`"); continue;}
+            if (std::find(m_msgNames.begin(), m_msgNames.end(), tokens[1].text) != m_msgNames.end()) {error("'" + tokens[1].text + "' already declared"); continue;}
+
+            const Message* schema = nullptr;
+            if (count == 3)
+            {
+                schema = table.lookupMessage(tokens[2].text);
+                if (!schema) schema = table.findMessageByTag(tokens[2].text);
+                if (!schema) {error("no message '" + tokens[2].text + "' in the XML"); continue;}
+            }
+            m_msgNames.push_back(tokens[1].text);
+            m_msgs.push_back(MessageInstance(schema));
+        }
+        else if (keyword == "set")
+        {
+            if (count != 4) {error("expected `set <msg> \"<field>\" <value>`"); continue;}
+            int msg = findBoundMsg(tokens[1]);
+            if (msg < 0) continue;
+            if (!m_msgs[msg].getSchema()->isEditable()) {error(tokens[1].text + " is not an editable (outgoing) message"); continue;}
+
+            FieldHandle field = findField(msg, tokens[2]);
+            if (!field.isValid()) continue;
+
+            const MessageField& schemaField = field.schema->getDataFormat()[field.index];
+            if (schemaField.getTypeEnum() == MessageField::string)
+            {
+                if (!tokens[3].quoted) {error("string fields take a \"quoted\" value"); continue;}
+                Op& op = emit(SET_TEXT);
+                op.msg = msg; op.field = field; op.text = tokens[3].text;
+            }
+            else if (isInteger(schemaField))
+            {
+                Op& op = emit(SET_INT);
+                op.msg = msg; op.field = field;
+                if (!parseInt(tokens[3], op.value)) error("expected an integer, got '" + tokens[3].text + "'");
+            }
+            else error("\"" + tokens[2].text + "\" (" + std::string(schemaField.getType()) + ") cannot be set from a sequence");
+        }
+        else if (keyword == "setbit")
+        {
+            if (count != 5) {error("expected `setbit <msg> \"<field>\" \"<bit name>\" 0|1`"); continue;}
+            int msg = findBoundMsg(tokens[1]);
+            if (msg < 0) continue;
+            if (!m_msgs[msg].getSchema()->isEditable()) {error(tokens[1].text + " is not an editable (outgoing) message"); continue;}
+
+            Op& op = emit(SET_BIT);
+            op.msg  = msg;
+            op.mask = findBit(msg, tokens[2], tokens[3]);
+            if (!parseInt(tokens[4], op.value) || op.value < 0 || op.value > 1) error("expected 0 or 1, got '" + tokens[4].text + "'");
+        }
+        else if (keyword == "send")
+        {
+            if (count < 2 || count > 3) {error("expected `send <msg> [<response msg>]`"); continue;}
+            int msg = findBoundMsg(tokens[1]);
+            if (msg < 0) continue;
+            if (!m_msgs[msg].getSchema()->isOutgoing()) {error(tokens[1].text + " is not an outgoing message"); continue;}
+
+            Op& op = emit(SEND);
+            op.msg = msg;
+            if (count == 3) op.response = findMsg(tokens[2]);
+        }
+        else if (keyword == "retry")
+        {
+            // Applies to every send of the command, in every sequence, from now on (compiling is single threaded, running isn't)
+            int64_t retries;
+            if (count != 3 || !parseInt(tokens[2], retries) || retries < 0) {error("expected `retry <msg> <retries>`"); continue;}
+            int msg = findBoundMsg(tokens[1]);
+            if (msg < 0) continue;
+            if (!m_msgs[msg].getSchema()->isOutgoing()) {error(tokens[1].text + " is not an outgoing message"); continue;}
+
+            RetryPolicy policy = commRetry.getPolicy(m_msgs[msg].getSchema());
+            policy.retries = int(retries);
+            commRetry.setPolicy(m_msgs[msg].getSchema(), policy);
+        }
+        else if (keyword == "wait")
+        {
+            Op& op = emit(WAIT);
+            if (count != 2 || !parseInt(tokens[1], op.value) || op.value < 0) error("expected `wait <milliseconds>`");
+        }
+        else if (keyword == "repeat")
+        {
+            Op& op = emit(REPEAT);
+            op.counter = m_counters++;
+            if (count != 2 || !parseInt(tokens[1], op.value) || op.value < 0) error("expected `repeat <count>`");
+            blocks.push_back({REPEAT_BLOCK, lineNumber, int(m_ops.size()), int(m_ops.size()) - 1, {}});
+        }
+        else if (keyword == "loop")
+        {
+            if (count != 1) error("expected `loop`");
+            blocks.push_back({LOOP, lineNumber, int(m_ops.size()), -1, {}});
+        }
+        else if (keyword == "while" || keyword == "if")
+        {
+            int start = int(m_ops.size());
+            Op& op = emit(JUMP_UNLESS);
+            parseCondition(1, op.condition);
+            blocks.push_back({keyword == "if" ? IF : WHILE, lineNumber, start, start, {}});
+        }
+        else if (keyword == "else")
+        {
+            if (blocks.empty() || blocks.back().kind != IF) {error("`else` without `if`"); continue;}
+            emit(JUMP);
+            m_ops[blocks.back().patch].target = int(m_ops.size());
+            blocks.back().kind  = ELSE;
+            blocks.back().patch = int(m_ops.size()) - 1;
+        }
+        else if (keyword == "break")
+        {
+            int loop = int(blocks.size()) - 1;
+            while (loop >= 0 && (blocks[loop].kind == IF || blocks[loop].kind == ELSE)) loop--;
+            if (loop < 0) {error("`break` outside of repeat/loop/while"); continue;}
+
+            emit(JUMP);
+            blocks[loop].breaks.push_back(int(m_ops.size()) - 1);
+        }
+        else if (keyword == "end")
+        {
+            if (blocks.empty()) {error("`end` without a block"); continue;}
+            Block block = blocks.back();
+            blocks.pop_back();
+
+            switch (block.kind)
+            {
+                case REPEAT_BLOCK:
+                {
+                    Op& op = emit(REPEAT_END);
+                    op.counter = m_ops[block.patch].counter;
+                    op.target  = block.start;
+                    break;
+                }
+                case LOOP:
+                case WHILE:
+                    emit(JUMP).target = block.start;
+                    break;
+                default:
+                    break;
+            }
+
+            if (block.patch >= 0) m_ops[block.patch].target = int(m_ops.size());
+            for (int jump : block.breaks) m_ops[jump].target = int(m_ops.size());
+        }
+        else if (keyword == "print")
+        {
+            if (count == 2 && tokens[1].quoted) emit(PRINT_TEXT).text = tokens[1].text;
+            else if (count == 2)
+            {
+                int msg = findMsg(tokens[1]);
+                if (msg >= 0) emit(PRINT_MSG).msg = msg;
+            }
+            else if (count == 3)
+            {
+                int msg = findBoundMsg(tokens[1]);
+                if (msg < 0) continue;
+
+                Op& op = emit(PRINT_FIELD);
+                op.msg   = msg;
+                op.field = findField(msg, tokens[2]);
+                op.text  = tokens[2].text;
+            }
+            else error("expected `print \"text\"`, `print <msg>` or `print <msg> \"<field>\"`");
+        }
+        else if (keyword == "stop")
+        {
+            if (count != 1) error("expected `stop`");
+            emit(STOP);
+        }
+        else error("unknown statement '" + keyword + "'");
+    }
+
+    for (const Block& block : blocks)
+    {
+        lineNumber = block.line;
+        error("block not closed with `end`");
+    }
+    return ok;
+}
+
+/* Running ===================================================================================== */
+
+bool Sequence::evaluate(const Condition& condition, const std::vector<MessageInstance>& msgs) const
+{
+    const MessageInstance& msg = msgs[condition.msg];
+    bool result;
+
+    if (condition.compare == BIT) result = msg.testMask(condition.mask);
+    else
+    {
+        int64_t value;
+        if (!fieldValueToInt(msg.getValue(condition.field), value)) return false;
+
+        switch (condition.compare)
+        {
+            case EQ: result = value == condition.value; break;
+            case NE: result = value != condition.value; break;
+            case LT: result = value <  condition.value; break;
+            case LE: result = value <= condition.value; break;
+            case GT: result = value >  condition.value; break;
+            case GE: result = value >= condition.value; break;
+            default: result = false;                    break;
+        }
+    }
+    return result != condition.negate;
+}
+
+comm_error Sequence::run(const std::atomic<bool>* stop) const
+{
+    std::vector<MessageInstance> msgs(m_msgs);
+    std::vector<int64_t>         counters(m_counters);
+
+    int pc = 0;
+    while (pc < int(m_ops.size()))
+    {
+        if (stop && *stop) return NONE;
+
+        const Op& op = m_ops[pc++];
+        switch (op.code)
+        {
+            case SET_INT:  msgs[op.msg].setInt(op.field, uint64_t(op.value)); break;
+            case SET_TEXT: msgs[op.msg].setText(op.field, op.text);            break;
+            case SET_BIT:  msgs[op.msg].setBit(op.mask, op.value != 0);        break;
+            case SEND:
+            {
+                MessageInstance* response = (op.response >= 0) ? &msgs[op.response] : nullptr;
+                comm_error error;
+                {
+                    std::lock_guard<std::mutex> lock(busMutex);
+                    error = msgs[op.msg].sendMessage(response);
+                }
+
+                const Message* expected = (op.response >= 0) ? m_msgs[op.response].getSchema() : nullptr;
+                if (error == NONE && expected && response->getSchema() != expected)
+                {
+                    std::lock_guard<std::mutex> lock(printMutex);
+                    std::cout << "ERROR: " << m_name << ":" << op.line << ": expected " << expected->getMsgName() << ", received "
+                              << (response->getSchema() ? response->getSchema()->getMsgName() : std::string_view("nothing")) << '\n';
+                    return INVALID_MSG;
+                }
+                if (error != NONE)
+                {
+                    std::lock_guard<std::mutex> lock(printMutex);
+                    std::cout << "ERROR: " << m_name << ":" << op.line << ": send " << m_msgNames[op.msg] << " failed with error: " << error << '\n';
+                    return error;
+                }
+                break;
+            }
+            case WAIT:
+            {
+                std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::milliseconds(op.value);
+                while (std::chrono::steady_clock::now() < end && !(stop && *stop))
+                    std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(end - std::chrono::steady_clock::now(), std::chrono::milliseconds(10)));
+                break;
+            }
+            case JUMP:        pc = op.target; break;
+            case JUMP_UNLESS: if (!evaluate(op.condition, msgs)) pc = op.target; break;
+            case REPEAT:
+                counters[op.counter] = op.value;
+                if (op.value == 0) pc = op.target;
+                break;
+            case REPEAT_END:  if (--counters[op.counter] > 0) pc = op.target; break;
+            case PRINT_MSG:
+            {
+                std::lock_guard<std::mutex> lock(printMutex);
+                std::cout << "[" << m_name << "] ";
+                msgs[op.msg].printMsg();
+                break;
+            }
+            case PRINT_FIELD:
+            {
+                std::lock_guard<std::mutex> lock(printMutex);
+                std::cout << "[" << m_name << "] " << m_msgNames[op.msg] << " " << op.text << " = " << fieldValueToString(msgs[op.msg].getValue(op.field)) << '\n';
+                break;
+            }
+            case PRINT_TEXT:
+            {
+                std::lock_guard<std::mutex> lock(printMutex);
+                std::cout << "[" << m_name << "] " << op.text << '\n';
+                break;
+            }
+            case STOP: return NONE;
+        }
+    }
+    return NONE;
+}
@@ -0,0 +1,92 @@
+#ifndef SEQUENCE_H
+#define SEQUENCE_H
+
+#include "../serial/lf_comm.h"
+
+#include <atomic>
+
+/**
+ * @brief A Sequence is a command sequence written in a small text language, so
+ * cycles can be adjusted without a compiler (see `./sequencer` and scripts/example.seq).
+ *
+ * The text is compiled once: message names, fields and bits are resolved
+ * against the table into handles and masks, blocks into jumps. Running it only
+ * executes the resolved steps, which call straight into MessageInstance
+ * (setInt(), sendMessage(), getValue(), testMask()), so the time spent on the
+ * wire is the same as a compiled main.cpp.
+ *
+ *      # one statement per line, names with spaces between quotes
+ *      msg cmd MDB_Rpm_Command                 # declares a message (a MessageInstance)
+ *      msg rsp MDB_Rpm_Report                  # the expected response
+ *      set cmd "rpm command" 1000              # integer (decimal or 0x..) or "text" for strings
+ *      setbit cmd "status0" "motor enabled" 1
+ *      send cmd rsp                            # sendMessage(&rsp), `send cmd` without a response
+ *      retry cmd 2                             # resend cmd up to 2 times on a transient error (none by default)
+ *      wait 500                                # milliseconds
+ *      repeat 10 ... end                       # also `loop ... end` (until stopped) and `break`
+ *      while rsp "actual rpm" < 900 ... end    # conditions: <msg> "<field>" <op> <integer>
+ *      if not rsp "status0" bit "motor stopped"    #             <msg> "<field>" bit "<bit name>"
+ *      else ... end                            # ops: == != < <= > >=
+ *      print rsp "actual rpm"                  # also `print rsp` (whole message) and `print "text"`
+ *      stop                                    # ends the sequence
+ *
+ * Several sequences can run at once, each on its own thread: sends are
+ * serialized on the single serial port (one exchange at a time), waits are not.
+ * A failed send ends the sequence with its comm_error.
+ */
+
+class Sequence
+{
+    public:
+        Sequence() : m_counters(0) {}
+
+        // Compiles `source`, errors are printed with their line number
+        // @return false if anything could not be compiled or resolved
+        bool compile(const std::string& source, const MessageTable& table, const std::string& name = "sequence");
+        bool load(const std::string& path, const MessageTable& table);
+
+        // Runs the sequence on the calling thread until its end, `stop`, a failed send or `*stop` being set
+        // @return NONE, or the comm_error of the send that failed
+        comm_error run(const std::atomic<bool>* stop = nullptr) const;
+
+        const std::string& getName()  const { return m_name; }
+        int                getSteps() const { return int(m_ops.size()); }
+    private:
+        enum OpCode { SET_INT, SET_TEXT, SET_BIT, SEND, WAIT, JUMP, JUMP_UNLESS, REPEAT, REPEAT_END, PRINT_MSG, PRINT_FIELD, PRINT_TEXT, STOP };
+        enum Compare { EQ, NE, LT, LE, GT, GE, BIT };
+
+        struct Condition
+        {
+            int         msg     = -1;
+            FieldHandle field   = {nullptr, -1};
+            Compare     compare = EQ;
+            int64_t     value   = 0;
+            BitMask     mask    = {-1, 0};
+            bool        negate  = false;
+        };
+
+        struct Op
+        {
+            OpCode      code;
+            int         line;
+            int         msg       = -1;             // index into m_msgs
+            int         response  = -1;             // SEND: index into m_msgs, -1 for none
+            FieldHandle field     = {nullptr, -1};
+            BitMask     mask      = {-1, 0};
+            int64_t     value     = 0;              // integer to set, bit value, ms to wait, repeat count
+            std::string text;
+            Condition   condition;                  // JUMP_UNLESS
+            int         target    = -1;             // JUMP*, REPEAT (past the end) and REPEAT_END (body start)
+            int         counter   = -1;             // REPEAT*: index of the repeat counter
+        };
+
+        bool evaluate(const Condition& condition, const std::vector<MessageInstance>& msgs) const;
+
+        std::string                  m_name;
+        std::vector<std::string>     m_msgNames;
+        std::vector<MessageInstance> m_msgs;        // initial state, copied by every run()
+        std::vector<Op>              m_ops;
+        int                          m_counters;
+};
+
+#endif // SEQUENCE_H
@@ -0,0 +1,64 @@
+#include "sequence.h"
+
+#include <csignal>
+#include <thread>
+using namespace std;
+INITIALIZE_EASYLOGGINGPP
+
+MessageTable table;
+
+/*
+ * Runs command sequences written in the Sequence language (see sequence.h),
+ * no compiler needed to change them. Every file runs on its own thread, all
+ * of them sharing the serial port:
+ *
+ *      ./sequencer [--xml dtCommandsTMEV.xml] scripts/example.seq [more.seq ...] /dev/ttyUSB0 [-v]
+ */
+
+static atomic<bool> stopSequences(false);
+
+static void onSignal(int) {stopSequences = true;}
+
+int main (int argc, char **argv)
+{
+    string xmlFile = "dtCommandsTMEV.xml";
+
+    int first = 1;
+    if (argc > 2 && !strcmp(argv[1], "--xml")) {xmlFile = argv[2]; first = 3;}
+
+    // The device (and -v) come last, as for ./main
+    int deviceIdx = argc - 1;
+    if (deviceIdx > first && (!strcmp(argv[deviceIdx], "-v") || !strcmp(argv[deviceIdx], "-V") || !strcmp(argv[deviceIdx], "--verbose"))) deviceIdx--;
+    if (deviceIdx <= first) {cout << "ERROR: No sequence or USB device file specified.\nTry something like this:\n./sequencer scripts/example.seq /dev/ttyUSB0\n"; return 1;}
+
+    if (!loadDocument(xmlFile, table)) return 1;
+
+    // Everything is compiled before the port is opened
+    vector<Sequence> sequences(deviceIdx - first);
+    bool compiled = true;
+    for (int i = first; i < deviceIdx; i++)
+        compiled &= sequences[i - first].load(argv[i], table);
+    if (!compiled) return 1;
+
+    int    commArgc = argc - deviceIdx + 1;
+    char** commArgv = argv + deviceIdx - 1;     // last sequence stands in for argv[0]
+    if (!initComm(commArgc, commArgv)) return 1;
+    initLogger();
+
+    signal(SIGINT,  onSignal);
+    signal(SIGTERM, onSignal);
+
+    vector<comm_error> results(sequences.size(), NONE);
+    vector<thread>     threads;
+    for (size_t i = 0; i < sequences.size(); i++)
+        threads.emplace_back([&, i]() { results[i] = sequences[i].run(&stopSequences); });
+
+    int failed = 0;
+    for (size_t i = 0; i < threads.size(); i++)
+    {
+        threads[i].join();
+        cout << sequences[i].getName() << ": " << (results[i] == NONE ? "done" : "failed") << '\n';
+        failed += (results[i] != NONE);
+    }
+    return failed ? 1 : 0;
+}
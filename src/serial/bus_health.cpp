@@ -0,0 +1,119 @@
+#include "bus_health.h"
+#include "../logger/log.h"
+
+#include <cstring>
+#include <sstream>
+
+BusHealth busHealth;
+
+const char* commErrorName(comm_error error)
+{
+    static const char* names[COMM_ERROR_COUNT] = {
+        "NONE", "BAD_CHECKSUM", "TIMEOUT", "EMPTY_READ", "INVALID_MSG", "IO_ERROR", "BAD_FRAME",
+        "FIFO_OVERRUN", "FRAMING_ERROR", "PARITY_ERROR", "DATA_PRESENT_BEFORE_NEXT_PACKET", "PINSWAP_TIMEOUT"
+    };
+    return (error >= 0 && error < COMM_ERROR_COUNT) ? names[error] : "UNKNOWN";
+}
+
+BusHealth::BusHealth()
+{
+    reset();
+}
+
+void BusHealth::reset()
+{
+    std::memset(m_buckets, 0, sizeof(m_buckets));
+    std::memset(m_totals,  0, sizeof(m_totals));
+    m_bytes         = 0;
+    m_timeoutsInRow = 0;
+}
+
+BusHealth::Bucket& BusHealth::current()
+{
+    uint64_t second = monotonicNanos() / 1000000000;
+    Bucket&  bucket = m_buckets[second % HEALTH_WINDOW_S];
+
+    // Left over from a previous lap of the ring
+    if (bucket.second != second) {std::memset(&bucket, 0, sizeof(bucket)); bucket.second = second;}
+    return bucket;
+}
+
+void BusHealth::recordExchange(comm_error result)
+{
+    Bucket& bucket = current();
+    bucket.exchanges++;
+    if (result == NONE) {m_timeoutsInRow = 0; return;}
+
+    bucket.failed++;
+
+    // A FIFO_OVERRUN outcome was already counted by recordEvent() when the overrun was detected
+    if (result == FIFO_OVERRUN) return;
+    bucket.counts[result]++;
+    m_totals[result]++;
+}
+
+void BusHealth::recordEvent(comm_error event, int count)
+{
+    if (count <= 0 || event <= NONE || event >= COMM_ERROR_COUNT) return;
+
+    current().counts[event] += count;
+    m_totals[event]         += count;
+}
+
+void BusHealth::recordBytes(int count)
+{
+    if (count > 0) m_bytes += count;
+}
+
+comm_error BusHealth::classifyTimeout()
+{
+    m_timeoutsInRow++;
+    return (m_bytes == 0 && m_timeoutsInRow >= PINSWAP_TIMEOUTS) ? PINSWAP_TIMEOUT : TIMEOUT;
+}
+
+uint32_t BusHealth::getCount(comm_error error, int windowS) const
+{
+    if (error < 0 || error >= COMM_ERROR_COUNT) return 0;
+
+    uint64_t now   = monotonicNanos() / 1000000000;
+    uint32_t total = 0;
+    for (const Bucket& bucket : m_buckets)
+        if (now - bucket.second < uint64_t(std::min(windowS, HEALTH_WINDOW_S))) total += bucket.counts[error];
+    return total;
+}
+
+uint32_t BusHealth::getExchanges(int windowS) const
+{
+    uint64_t now   = monotonicNanos() / 1000000000;
+    uint32_t total = 0;
+    for (const Bucket& bucket : m_buckets)
+        if (now - bucket.second < uint64_t(std::min(windowS, HEALTH_WINDOW_S))) total += bucket.exchanges;
+    return total;
+}
+
+double BusHealth::getErrorRate(int windowS) const
+{
+    uint64_t now       = monotonicNanos() / 1000000000;
+    uint32_t exchanges = 0, failed = 0;
+    for (const Bucket& bucket : m_buckets)
+    {
+        if (now - bucket.second >= uint64_t(std::min(windowS, HEALTH_WINDOW_S))) continue;
+        exchanges += bucket.exchanges;
+        failed    += bucket.failed;
+    }
+    return exchanges ? double(failed) / exchanges : 0.0;
+}
+
+std::string BusHealth::getSummary(int windowS) const
+{
+    std::ostringstream summary;
+    summary << std::min(windowS, HEALTH_WINDOW_S) << "s: " << getExchanges(windowS) << " exchanges, "
+            << std::fixed << std::setprecision(1) << getErrorRate(windowS) * 100 << "% failed";
+
+    for (int error = NONE + 1; error < COMM_ERROR_COUNT; error++)
+    {
+        uint32_t count = getCount(comm_error(error), windowS);
+        if (count) summary << ", " << commErrorName(comm_error(error)) << ' ' << count;
+    }
+    return summary.str();
+}
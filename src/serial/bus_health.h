@@ -0,0 +1,70 @@
+#ifndef BUS_HEALTH_H
+#define BUS_HEALTH_H
+
+#include "comm_errors.h"
+
+#include <stdint.h>
+#include <string>
+
+#define HEALTH_WINDOW_S     60      // longest window the rolling counters cover
+#define PINSWAP_TIMEOUTS    3       // timeouts in a row, with nothing received since the port opened
+
+/**
+ * @brief The BusHealth keeps rolling counters of everything that goes wrong on
+ * the serial line, so a script (or whoever reads the logs) can tell a port
+ * is degrading and slow down or reset it before exchanges start failing:
+ *
+ *      if (busHealth.getErrorRate(10) > 0.05) {...}        // over 5% of the last 10 s
+ *      std::cout << busHealth.getSummary(60) << '\n';
+ *
+ * Exchange results are recorded by sendPacket(), line events (overruns,
+ * framing/parity errors, stray bytes) by commRead() as they are detected, from
+ * the kernel's counters (TIOCGICOUNT on Linux, ClearCommError() on Windows)
+ * and the PARMRK markers in the data. An exchange failing with FIFO_OVERRUN
+ * counts as a failed exchange, its overruns only once, as line events.
+ * Counts are kept per second for the last
+ * HEALTH_WINDOW_S seconds. Not thread safe, like the rest of the engine.
+ */
+class BusHealth
+{
+    public:
+        BusHealth();
+
+        void recordExchange(comm_error result);             // NONE for a good exchange, line events aren't counted again
+        void recordEvent(comm_error event, int count = 1);  // line event, not ending the exchange
+        void recordBytes(int count);                        // bytes received, for PINSWAP_TIMEOUT
+
+        // TIMEOUT, or PINSWAP_TIMEOUT once PINSWAP_TIMEOUTS timeouts in a row happened without ever receiving a byte
+        comm_error classifyTimeout();
+
+        uint64_t getTotal(comm_error error)                 const { return m_totals[error]; }
+        uint32_t getCount(comm_error error, int windowS)    const;     // last `windowS` seconds (<= HEALTH_WINDOW_S)
+        uint32_t getExchanges(int windowS)                  const;     // exchanges (good or not) in the window
+        double   getErrorRate(int windowS)                  const;     // failed exchanges / exchanges, 0 when idle
+
+        // One line, ex. "60s: 120 exchanges, 2.5% failed, TIMEOUT 3, FIFO_OVERRUN 1"
+        std::string getSummary(int windowS) const;
+        void        reset();
+    private:
+        struct Bucket
+        {
+            uint64_t second;                    // monotonic second this bucket counts for
+            uint32_t exchanges;
+            uint32_t failed;
+            uint32_t counts[COMM_ERROR_COUNT];
+        };
+
+        Bucket& current();
+
+        Bucket   m_buckets[HEALTH_WINDOW_S];
+        uint64_t m_totals[COMM_ERROR_COUNT];
+        uint64_t m_bytes;
+        int      m_timeoutsInRow;
+};
+
+// Name used in logs and summaries, ex. "TIMEOUT"
+const char* commErrorName(comm_error error);
+
+extern BusHealth busHealth;
+
+#endif // BUS_HEALTH_H
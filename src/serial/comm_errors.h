@@ -6,7 +6,19 @@ enum comm_error {
     BAD_CHECKSUM,   // 1
     TIMEOUT,        // 2
     EMPTY_READ,     // 3
-    INVALID_MSG,    // 4
+    INVALID_MSG,    // 4 received header not in the table
+    IO_ERROR,       // 5 read()/write() on the port failed
+    BAD_FRAME,      // 6 impossible PackLen, caught before the rest of the packet arrived
+
+    // Bus health events (see BusHealth), counted as they happen, an exchange only
+    // fails with FIFO_OVERRUN (data lost) or PINSWAP_TIMEOUT (nothing ever received)
+    FIFO_OVERRUN,                       // 7 the UART or the kernel buffer dropped received bytes
+    FRAMING_ERROR,                      // 8 byte received without a valid stop bit (noise, wrong baud rate)
+    PARITY_ERROR,                       // 9 byte inside a packet received with the wrong parity
+    DATA_PRESENT_BEFORE_NEXT_PACKET,    // 10 stray bytes before the MARK byte starting a packet, dropped
+    PINSWAP_TIMEOUT,                    // 11 only timeouts and not a single byte since the port opened: TX/RX swapped?
+
+    COMM_ERROR_COUNT
 };
 
 #endif // COMM_ERRORS_H
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "lf_comm.h"
+#include "../parser/hex_codec.h"
 
 #if defined(_WIN32) || defined(_WIN64)
     #include "windows_comm.cpp"
@@ -10,19 +11,13 @@
 
 comm_t serialComm = {0};
 
-void printBuffer(uint8_t* buffer, uint8_t& size) 
+void printBuffer(const uint8_t* buffer, uint8_t& size) 
 {
-    for (uint8_t i = 0; i < size; ++i)
-        std::cout << std::uppercase 
-                  << std::setw(2) 
-                  << std::setfill('0') 
-                  << std::hex 
-                  << static_cast<int>(buffer[i]);
-                //   << ", ";
-    std::cout << '\n' << std::dec;
+    char text[0x200];   // 2 characters per byte, size is at most 0xFF
+    std::cout.write(text, encodeHex(buffer, size, text)) << '\n';
 }
 
-bool validateChecksum()
+bool validateChecksum(const comm_t& comm)
 {
     // Recall the checksum is computed as the Two's Complement (or negation)
     // of the sum of all bytes within a message. Adding all the bytes AND the
@@ -30,12 +25,82 @@ bool validateChecksum()
     // behavior of unsigned integers.
 
     uint8_t checksum = 0;
-	for (uint8_t i = 0; i < serialComm.inBuffer[PACKLEN_IDX]; i++)
-        checksum += serialComm.inBuffer[i];
+	for (uint8_t i = 0; i < comm.inBuffer[PACKLEN_IDX]; i++)
+        checksum += comm.inBuffer[i];
     
     return checksum == 0;
 }
 
+// TARGET:SOURCE:MSG_ID:PACKLEN of a received packet, only needed for the errors
+static std::string headerTag(const uint8_t* buffer)
+{
+    std::string tag;
+    for (int idx : {TARGET_IDX, SOURCE_IDX, MSG_ID_IDX, PACKLEN_IDX})
+        tag.append(tag.empty() ? "" : ":").append(hexPair(buffer[idx]), 2);
+    return tag;
+}
+
+comm_error checkFrame(const comm_t& comm)
+{
+    if (comm.inBuffer[PACKLEN_IDX] < MIN_PACK_LEN)
+    {
+        std::cout << "ERROR_BAD_FRAME 0x";
+        uint8_t size = uint8_t(std::min<int>(comm.head, HEADER_LEN));
+        printBuffer(comm.inBuffer, size);
+        return BAD_FRAME;
+    }
+    if (!table.findMessageByHeader(comm.inBuffer))
+    {
+        std::cout << "ERROR: Received message '" << headerTag(comm.inBuffer) << "' not found...\n";
+        return INVALID_MSG;
+    }
+    return NONE;
+}
+
+void commFrame(comm_t& comm)
+{
+    // The header is checked once, by the read that completes it
+    bool headerIn = comm.summed < HEADER_LEN && comm.head >= HEADER_LEN;
+
+    // Every byte is added once, when it arrives, so the checksum is known as soon as the packet is complete
+    for (; comm.summed < comm.head; comm.summed++) comm.sum += comm.inBuffer[comm.summed];
+
+    // Malformed or unknown header: fail now rather than wait for bytes that may never come
+    comm_error frame = headerIn ? checkFrame(comm) : NONE;
+    if (frame != NONE)
+    {
+        uint8_t received = uint8_t(std::min<int>(comm.head, 0xFF));
+        comm.errorState = frame;
+        if (comm.verbose) logMessage(comm.errorState, In, comm.inBuffer, received, comm.rxTimestamp);
+        commFlushInput(comm);
+    }
+
+    // After all bytes have been read in
+    else if (comm.head >= MIN_PACK_LEN && comm.head >= comm.inBuffer[PACKLEN_IDX])
+    {
+        // Check for a good CS: a good packet, checksum included, adds up to 0 (bytes read past its end taken back out)
+        uint8_t sum = comm.sum;
+        for (int i = comm.inBuffer[PACKLEN_IDX]; i < comm.head; i++) sum -= comm.inBuffer[i];
+
+        if (sum != 0)
+        {
+            std::cout << "ERROR_BAD_CHECKSUM 0x";
+            printBuffer(comm.inBuffer, comm.inBuffer[PACKLEN_IDX]);
+            comm.errorState = BAD_CHECKSUM;
+        }
+
+        else
+        {
+            // Capture logs
+            if (comm.verbose) logMessage(comm.errorState, In, comm.inBuffer, comm.inBuffer[PACKLEN_IDX], comm.rxTimestamp);
+
+            // Triggers are checked on the raw bytes, before anything is decoded (their callbacks run after the exchange)
+            if (triggers.isActive()) triggers.evaluate(comm.inBuffer, comm.rxTimestamp);
+        }
+        comm.mode = DONE;
+    }
+}
+
 void commFSM()
 {
     switch (serialComm.mode) 
@@ -52,8 +117,16 @@ void commFSM()
 	}
 }
 
-bool sendPacket(Message *toBeSent)
+bool sendPacket(const MessageInstance *toBeSent)
 {
+    // The whole exchange runs on the serial thread when it is started
+    if (serialThread.isRunning() && !serialThread.isCurrent())
+    {
+        bool sent = false;
+        serialThread.run([&]() { sent = sendPacket(toBeSent); });
+        return sent;
+    }
+
     // Expect a response from EVERY message
     // NOTE that BOOT commands may not have a response, need to add functionality for this later
     serialComm.response = 1;
@@ -69,45 +142,44 @@ bool sendPacket(Message *toBeSent)
     serialComm.head = 0;
     serialComm.errorState = NONE;
 
+    // No sleep between steps: write() blocks until the bytes are queued and read() until bytes
+    // arrive or the VTIME (ReadTotalTimeoutConstant on Windows) timeout, so each step waits on the port itself
     while (serialComm.mode != DONE)
     {
         commFSM();
-        usleep(100000);
 
-        if (serialComm.errorState != NONE) return false;
+        if (serialComm.errorState != NONE) {busHealth.recordExchange(serialComm.errorState); return false;}
     }
 
+    busHealth.recordExchange(NONE);
     return true;
 }
 
-void handleResponse()
+comm_error handleResponse(MessageInstance *response, const comm_t& comm)
 {
-    std::string incomingTag;
-    std::stringstream ss;
+    const Message *received = table.findMessageByHeader(comm.inBuffer);
 
-    // uint8_t --> hex string
-    ss << std::hex << std::uppercase << std::setfill('0') << std::setw(2)
-    << static_cast<int>(serialComm.inBuffer[TARGET_IDX]) << ":"
-    << std::setw(2) << static_cast<int>(serialComm.inBuffer[SOURCE_IDX]) << ":"
-    << std::setw(2) << static_cast<int>(serialComm.inBuffer[MSG_ID_IDX]);
+    if (received == nullptr)
+    {
+        std::cout << "ERROR: Received message '" << headerTag(comm.inBuffer) << "' not found...\n";
+        return INVALID_MSG;
+    }
 
-    incomingTag = ss.str();
-    
-    Message *toUpdate = table.findMessageByTag(incomingTag);
+    // One copy of the data bytes, fields are only decoded when the script reads them
+    int dataWidth = comm.inBuffer[PACKLEN_IDX] - MIN_PACK_LEN;
+    bool observed = changeTracker.isEnabled() || telemetryStore.isOpen();
+    if (!response && !observed) return NONE;
 
-    // Try appending the packet length and looking (ex. Push Report)
-    if (toUpdate == nullptr)
+    MessageInstance local;
+    MessageInstance& report = response ? *response : local;
+    if (!report.assign(received, comm.inBuffer + DATA_IDX, dataWidth))
     {
-        std::stringstream ss1;
-        ss1 << std::hex << std::uppercase << std::setfill('0') << std::setw(2)
-        << static_cast<int>(serialComm.inBuffer[TARGET_IDX]) << ":"
-        << std::setw(2) << static_cast<int>(serialComm.inBuffer[SOURCE_IDX]) << ":"
-        << std::setw(2) << static_cast<int>(serialComm.inBuffer[MSG_ID_IDX]) << ":"
-        << std::setw(2) << static_cast<int>(serialComm.inBuffer[PACKLEN_IDX]);
-        incomingTag = ss1.str();
-        toUpdate = table.findMessageByTag(incomingTag);
+        std::cout << "ERROR: Received " << received->getMsgName() << " with " << dataWidth << " data bytes, expected "
+                  << received->getPackLen() - MIN_PACK_LEN << "...\n";
+        return INVALID_MSG;
     }
 
-    int dataWidth = serialComm.inBuffer[PACKLEN_IDX] - MIN_PACK_LEN;
-    toUpdate->setDataBuffer(std::vector<BYTE>(serialComm.inBuffer + DATA_IDX, serialComm.inBuffer + DATA_IDX + dataWidth));
-}
\ No newline at end of file
+    if (changeTracker.isEnabled()) changeTracker.update(report);
+    if (telemetryStore.isOpen())   telemetryStore.record(report, timeSinceEpoch());
+    return NONE;
+}
@@ -2,15 +2,31 @@
 #define LF_COMM_H
 
 #include "../parser/xml_handler.h"
+#include "../parser/change_tracker.h"
 #include "../logger/log.h"
+#include "../logger/telemetry_store.h"
 #include "../serial/comm_errors.h"
+#include "../serial/bus_health.h"
+#include "../serial/serial_thread.h"
+#include "../serial/trigger.h"
+#include "../serial/response_cache.h"
+#include "../serial/retry_policy.h"
 
 #include <stdint.h>
 #include <regex>
 #include <unistd.h>
 
 #define TIMEOUT_MS	 1000		// Message timeout (in ms)
+#define PACKET_TIMEOUT_S 2		// whole packet timeout (in s), comm_t::timeoutDuration
 #define BAUD_RATE 	 28800
+#define LOW_LATENCY	 false		// Linux: driver low latency flag and 1 ms USB adapter latency timer, see setLowLatency()
+#define LATENCY_TIMER_MS 1		// USB adapter latency timer set by LOW_LATENCY (FTDI defaults to 16 ms)
+
+// Dedicated serial thread (see SerialThread), started by initComm()
+#define SERIAL_THREAD		   false
+#define SERIAL_THREAD_PRIORITY 80		// SCHED_FIFO priority (1-99), 0 for the normal scheduler
+#define SERIAL_THREAD_CPU	   -1		// core to pin it to, -1 for any
+#define SERIAL_THREAD_MLOCK	   true		// lock the process memory (Linux)
 
 #define TARGET_IDX	 0
 #define PACKLEN_IDX  1
@@ -41,13 +57,32 @@ typedef struct comm_t {
 	enum comm_mode mode;
 	uint64_t fileDescriptor;
 	enum comm_error errorState;
+	uint64_t txTimestamp;		// monotonicNanos() right after the first byte of the last packet was written
+	uint64_t rxTimestamp;		// monotonicNanos() right after the read() returning the first bytes of the last packet
+	uint8_t marked;				// Linux: the packet being read started with a MARK byte (see unstuffInput())
+	uint8_t sum;				// running sum of inBuffer[0..summed), added up by commFrame() as bytes arrive
+	uint16_t summed;			// reset with `sum` whenever a new packet starts at inBuffer[0]
 } comm_t;
 
 extern comm_t serialComm;
 
-void printBuffer(uint8_t* buffer, uint8_t& size);
+void printBuffer(const uint8_t* buffer, uint8_t& size);
+
+// Adds up the whole packet in `comm.inBuffer` (the framer checks the running `comm.sum` instead)
+bool validateChecksum(const comm_t& comm = serialComm);
 
-bool validateChecksum();
+// Checks the header of the packet being read, once its HEADER_LEN bytes are in
+// @return BAD_FRAME if its PackLen is impossible, INVALID_MSG if it is not in the table, NONE otherwise
+comm_error checkFrame(const comm_t& comm = serialComm);
+
+/*
+ * Called by commRead() (and UringComm) once received bytes are appended to `comm.inBuffer`
+ * and `comm.head` is past them: adds the new bytes to the running sum, checks the header with
+ * checkFrame() on the read that completes it (and fails the exchange right away if it is bad),
+ * and once the whole packet is in checks its checksum
+ * from that sum, logs it (if -v), runs the triggers and sets `comm.mode` to DONE.
+ */
+void commFrame(comm_t& comm);
 
 /********** PLATFORM-SPECIFIC FUNCTIONS **********/
 bool isValidComPort(const std::string& input);
@@ -59,6 +94,19 @@ bool processInput(int& argc, char **&argv);
 // @return true if successful
 bool initComm(int& argc, char **&argv);
 
+// Opens and configures `device` directly (no argument checks), used by initComm() and the benchmarks
+// @return true if successful
+bool openComm(const std::string& device);
+
+/*
+ * Reduces receive latency of `device` (called by openComm() when LOW_LATENCY is set):
+ * sets ASYNC_LOW_LATENCY through TIOCSSERIAL and writes LATENCY_TIMER_MS to the USB adapter's
+ * sysfs latency_timer when it has one (FTDI adapters hold bytes up to 16 ms otherwise).
+ * Prints the resulting settings. Linux only, Windows adapters are set in the Device Manager.
+ * @return true if every available setting was applied
+ */
+bool setLowLatency(const std::string& device);
+
 /*
  * Before calling this function, the OUT comm buffer is expected to be ready.
  * This means that the entire message needs to be on the buffer starting at idx=0.
@@ -77,16 +125,36 @@ void commWrite();
  */
 void commRead();
 
+// Drops whatever was received and not read yet (e.g. the late reply to a failed attempt)
+void commFlushInput(const comm_t& comm = serialComm);
+
 /*************************************************/
 
+#if defined(__linux__)
+/********** LINUX PORT HELPERS (shared with UringComm) **********/
+// Opens `device` configured like the main port, with VMIN/VTIME read settings
+// @return the file descriptor, -1 on failure
+int openPort(const std::string& device, uint8_t vmin, uint8_t vtime);
+
+// MARK parity for the first byte of a packet, SPACE for the rest and the reply
+void setMarkParity(int fd, bool mark);
+
+// Undoes the PARMRK stuffing of the `count` bytes just read at comm.inBuffer[comm.head]
+// @return the new head
+int unstuffInput(comm_t& comm, int count);
+#endif
+
 // Used to transition between reading/writing
 void commFSM();
 
 // @return true on success
-bool sendPacket(Message *toBeSent);
+bool sendPacket(const MessageInstance *toBeSent);
 
 // By the time this function is called,
 // inBuffer should already be populated
-void handleResponse();
+// Binds `response` (if not NULL) to the matching schema and copies in the received data,
+// the MessageTable itself is never modified.
+// @return INVALID_MSG if the received packet is not in the table, NONE otherwise
+comm_error handleResponse(MessageInstance *response, const comm_t& comm = serialComm);
 
 #endif // LF_COMM_H
\ No newline at end of file
@@ -3,10 +3,16 @@
 #include <sys/ioctl.h>
 #include <asm/ioctls.h>
 #include <asm/termbits.h>
+#include <linux/serial.h>
 #include <fcntl.h>
+#include <climits>
+#include <fstream>
 
 std::string usbFile;
 
+static bool                         icountSupported = true;     // false for PTYs and adapters without TIOCGICOUNT
+static struct serial_icounter_struct lastCounts;
+
 bool isValidComPort(const std::string& input) 
 {
     return std::regex_match(input, std::regex("^/dev/tty[A-Za-z0-9]*$"));
@@ -41,19 +47,37 @@ bool processInput(int& argc, char **&argv)
 
 bool initComm(int& argc, char **&argv)
 {
-    struct termios2 tio;
-
     // Ensure correct input
     if (!processInput(argc, argv)) return false;
+    if (!openComm(usbFile))         return false;
 
+    if (SERIAL_THREAD) serialThread.start({SERIAL_THREAD_PRIORITY, SERIAL_THREAD_CPU, SERIAL_THREAD_MLOCK});
+    return true;
+}
+
+bool openComm(const std::string& device)
+{
     // Open Serial port
-	serialComm.timeoutDuration = 2;
-	serialComm.fileDescriptor  = open(usbFile.c_str(), O_RDWR | O_NOCTTY);
+	serialComm.timeoutDuration = PACKET_TIMEOUT_S;
+	serialComm.fileDescriptor  = openPort(device, 0, TIMEOUT_MS/100);     // TIMEOUT/10 seconds timeout between empty reads
+	if (serialComm.fileDescriptor == uint64_t(-1)) return false;
 
-	if (serialComm.fileDescriptor == uint64_t(-1)) {std::cout << "open() failed with error " << strerror(errno) << '\n'; return false;}
+    // Baseline for the overrun/framing counters (not every driver has them)
+    icountSupported = ioctl(serialComm.fileDescriptor, TIOCGICOUNT, &lastCounts) == 0;
+
+    if (LOW_LATENCY) setLowLatency(device);
+    return true;
+}
+
+int openPort(const std::string& device, uint8_t vmin, uint8_t vtime)
+{
+    struct termios2 tio;
+
+	int fd = open(device.c_str(), O_RDWR | O_NOCTTY);
+	if (fd == -1) {std::cout << "open() failed with error " << strerror(errno) << '\n'; return -1;}
 
     // Configure Serial Port
-    ioctl(serialComm.fileDescriptor, TCGETS2, &tio);
+    ioctl(fd, TCGETS2, &tio);
 	tio.c_cflag &= ~CBAUD;
 	tio.c_cflag |= PARENB | CMSPAR | PARODD | BOTHER;
 	tio.c_iflag &= ~(IXON | IGNCR | ICRNL | IGNBRK | BRKINT);
@@ -62,13 +86,143 @@ bool initComm(int& argc, char **&argv)
 	tio.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
 	tio.c_ispeed = BAUD_RATE;
 	tio.c_ospeed = BAUD_RATE;
-    tio.c_cc[VMIN] = 0; // min number of bytes per read
 
     // Configure Timeouts
-    tio.c_cc[VTIME] = TIMEOUT_MS/100; // TIMEOUT/10 seconds timeout between empty reads
+    tio.c_cc[VMIN]  = vmin;     // min number of bytes per read
+    tio.c_cc[VTIME] = vtime;    // tenths of a second between bytes
 
-    ioctl(serialComm.fileDescriptor, TCSETS2, &tio);
-    return true;
+    ioctl(fd, TCSETS2, &tio);
+    return fd;
+}
+
+bool setLowLatency(const std::string& device)
+{
+    bool applied = true;
+
+    // Driver flag: received bytes are pushed to read() right away instead of on the next tty buffer flush
+    struct serial_struct serial;
+    if (ioctl(serialComm.fileDescriptor, TIOCGSERIAL, &serial) != 0)
+        std::cout << "Low latency: ASYNC_LOW_LATENCY not supported by this driver\n";
+    else
+    {
+        serial.flags |= ASYNC_LOW_LATENCY;
+        if (ioctl(serialComm.fileDescriptor, TIOCSSERIAL, &serial) != 0 || ioctl(serialComm.fileDescriptor, TIOCGSERIAL, &serial) != 0)
+            applied = false;
+
+        std::cout << "Low latency: ASYNC_LOW_LATENCY " << ((serial.flags & ASYNC_LOW_LATENCY) ? "on" : "off") << '\n';
+    }
+
+    // USB adapter latency timer, /sys/class/tty/ttyUSB0/device/latency_timer (needs write access, e.g. a udev rule)
+    char resolved[PATH_MAX];
+    std::string name = realpath(device.c_str(), resolved) ? resolved : device;
+    name = name.substr(name.find_last_of('/') + 1);
+
+    std::string timerPath = "/sys/class/tty/" + name + "/device/latency_timer";
+    std::ifstream timerIn(timerPath);
+    int before = -1;
+    if (!(timerIn >> before))
+    {
+        std::cout << "Low latency: no USB latency timer for " << name << '\n';
+        return applied;
+    }
+    timerIn.close();
+
+    std::ofstream timerOut(timerPath);
+    timerOut << LATENCY_TIMER_MS;
+    timerOut.close();
+
+    int after = -1;
+    std::ifstream(timerPath) >> after;
+    if (after != LATENCY_TIMER_MS) applied = false;
+
+    std::cout << "Low latency: " << timerPath << " " << after << " ms (was " << before << " ms)";
+    if (after != LATENCY_TIMER_MS) std::cout << ", could not set it to " << LATENCY_TIMER_MS << " ms (permission denied?)";
+    std::cout << '\n';
+    return applied;
+}
+
+void setMarkParity(int fd, bool mark)
+{
+    struct termios2 tio;
+    ioctl(fd, TCGETS2, &tio);
+    if (mark) tio.c_cflag |= PARODD;
+    else      tio.c_cflag &= ~PARODD;
+    ioctl(fd, TCSETS2, &tio);
+}
+
+// Ends the exchange with `error`, the caller (sendMessage()) decides whether to retry
+static void failExchange(comm_error error)
+{
+    serialComm.errorState = error;
+    serialComm.mode       = DONE;
+    serialComm.head       = 0;
+    setMarkParity(serialComm.fileDescriptor, true);
+}
+
+/*
+ * Undoes the PARMRK stuffing of the `count` bytes just read at inBuffer[head]:
+ * 0xFF 0xFF is a 0xFF data byte, 0xFF 0x00 X is X received with the wrong parity.
+ * While reading, the port expects SPACE parity, so the byte starting a packet
+ * (sent with MARK) is always marked. A marked byte after unmarked ones means
+ * those were stray data (dropped), a marked byte inside a packet is a parity error.
+ */
+int unstuffInput(comm_t& comm, int count)
+{
+    BYTE* buffer = comm.inBuffer;
+    int   end    = comm.head + count;
+    int   out    = comm.head;
+
+    for (int i = comm.head; i < end; i++)
+    {
+        if (buffer[i] != 0xFF || i + 1 >= end)      {buffer[out++] = buffer[i]; continue;}
+        if (buffer[i+1] == 0xFF)                    {buffer[out++] = 0xFF; i++; continue;}
+        if (buffer[i+1] != 0x00 || i + 2 >= end)    {buffer[out++] = buffer[i]; continue;}
+
+        i += 2;     // marked byte
+        if (out > 0 && !comm.marked)
+        {
+            uint8_t stray = uint8_t(std::min(out, 0xFF));
+            busHealth.recordEvent(DATA_PRESENT_BEFORE_NEXT_PACKET);
+            if (comm.verbose) logMessage(DATA_PRESENT_BEFORE_NEXT_PACKET, In, buffer, stray, monotonicNanos());
+
+            out = 0;
+            comm.sum         = 0;
+            comm.summed      = 0;
+            comm.rxTimestamp = monotonicNanos();
+        }
+        else if (out > 0)
+        {
+            busHealth.recordEvent(PARITY_ERROR);
+            if (comm.verbose) {uint8_t size = uint8_t(std::min(out, 0xFF)); logMessage(PARITY_ERROR, In, buffer, size, monotonicNanos());}
+        }
+
+        if (out == 0) comm.marked = true;
+        buffer[out++] = buffer[i];
+    }
+    return out;
+}
+
+// Kernel line counters since the last call go to busHealth
+// @return true if received bytes were lost (UART FIFO or tty buffer overrun)
+static bool checkLineCounters()
+{
+    struct serial_icounter_struct counts;
+    if (!icountSupported) return false;
+    if (ioctl(serialComm.fileDescriptor, TIOCGICOUNT, &counts) != 0) {icountSupported = false; return false;}
+
+    int overruns = (counts.overrun - lastCounts.overrun) + (counts.buf_overrun - lastCounts.buf_overrun);
+    int framing  = counts.frame - lastCounts.frame;
+    lastCounts   = counts;
+
+    busHealth.recordEvent(FIFO_OVERRUN,  overruns);
+    busHealth.recordEvent(FRAMING_ERROR, framing);
+    if (overruns && serialComm.verbose) logMessage(FIFO_OVERRUN, In, serialComm.inBuffer, serialComm.inBuffer[PACKLEN_IDX], monotonicNanos());
+    return overruns > 0;
+}
+
+void commFlushInput(const comm_t& comm)
+{
+    ioctl(comm.fileDescriptor, TCFLSH, TCIFLUSH);
 }
 
 void commWrite()
@@ -79,17 +233,20 @@ void commWrite()
      */
     int bytesToBeWritten = (serialComm.head) ? (serialComm.outBuffer[PACKLEN_IDX] - serialComm.head):(1);
     int bytesWritten     = write(serialComm.fileDescriptor, &serialComm.outBuffer[serialComm.head], bytesToBeWritten);
+    uint64_t writtenAt   = monotonicNanos();
 
     // Error handling
     if (bytesWritten == -1)
     {
         std::cout << "ERROR: bad write in interrupt\nerrorno: " << strerror(errno) << '\n';
-		exit(1);
+        failExchange(IO_ERROR);
+        return;
     }
     else if (bytesWritten == 0)
     {
         std::cout << "ERROR: commWrite() wrote 0 bytes\n";
-		exit(1);
+        failExchange(IO_ERROR);
+        return;
     }
 
     serialComm.head += bytesWritten;
@@ -97,12 +254,10 @@ void commWrite()
     // After writing the first byte
     if (serialComm.head == 1)
     {
-			struct timespec tsp;
-            struct termios2 tio;
-			clock_gettime(CLOCK_MONOTONIC, &tsp);
+            serialComm.txTimestamp = writtenAt;
 
             // Log the data (if -v)
-            if (serialComm.verbose) logMessage(serialComm.errorState, Out, serialComm.outBuffer, serialComm.outBuffer[PACKLEN_IDX]);
+            if (serialComm.verbose) logMessage(serialComm.errorState, Out, serialComm.outBuffer, serialComm.outBuffer[PACKLEN_IDX], serialComm.txTimestamp);
 
 			/*
             * Set 9th data bit to 0, this will remain set for the read, as Linux
@@ -110,9 +265,7 @@ void commWrite()
             */
             usleep(1000);   // Delay to avoid changing parity on the previously written byte.
 
-            ioctl(serialComm.fileDescriptor, TCGETS2, &tio);
-			tio.c_cflag &= ~PARODD;
-			ioctl(serialComm.fileDescriptor, TCSETS2, &tio);
+            setMarkParity(serialComm.fileDescriptor, false);
     }
     // After writing all bytes
     else if (serialComm.head >= serialComm.outBuffer[PACKLEN_IDX])
@@ -134,77 +287,45 @@ void commWrite()
 
 void commRead()
 {
-    struct timespec tsp;
-    struct termios  tio;
-
-    // Configuring read timeout
-    clock_gettime(CLOCK_MONOTONIC, &tsp);
-
     // Read and append incoming data to end of the input buffer
     int bytesRead = read(serialComm.fileDescriptor, &serialComm.inBuffer[serialComm.head], sizeof(serialComm.inBuffer) - serialComm.head);
-
-    // Strip framing error stuffing
-	for (int i = serialComm.head; i < serialComm.head + bytesRead - 1; i++)
-    {
-		if (serialComm.inBuffer[i] == 0xFF && serialComm.inBuffer[i+1] == 0xFF)
-        {
-			memmove(&serialComm.inBuffer[i], &serialComm.inBuffer[i+1], bytesRead - (i - serialComm.head) - 1);
-			bytesRead -= 1;
-		}
-		else if (serialComm.inBuffer[i] == 0xFF && serialComm.inBuffer[i+1] == 0x00)
-        {
-			memmove(&serialComm.inBuffer[i], &serialComm.inBuffer[i+2], bytesRead - (i - serialComm.head) - 2);
-			bytesRead -= 2;
-		}
-	}
+    uint64_t readAt = monotonicNanos();
+    if (serialComm.head == 0 && bytesRead > 0) serialComm.rxTimestamp = readAt;
+    if (serialComm.head == 0) {serialComm.marked = false; serialComm.sum = 0; serialComm.summed = 0;}
 
     // Error handling
     if (bytesRead == -1)
     {
         std::cout << "ERROR: bad read \nerrorno: " << strerror(errno) << '\n';
-		exit(1);
+        if (serialComm.verbose) logMessage(IO_ERROR, In, serialComm.inBuffer, serialComm.inBuffer[PACKLEN_IDX], readAt);
+        failExchange(IO_ERROR);
+        return;
     }
     else if (bytesRead == 0)    // Timeout case
     {
         serialComm.head = 0;
-		serialComm.errorState = TIMEOUT;
-        
-        if (serialComm.verbose) logMessage(serialComm.errorState, In, serialComm.inBuffer, serialComm.inBuffer[PACKLEN_IDX]);
+		serialComm.errorState = checkLineCounters() ? FIFO_OVERRUN : busHealth.classifyTimeout();
 
-        ioctl(serialComm.fileDescriptor, TCGETS2, &tio);
-		tio.c_cflag |= PARODD;
-		ioctl(serialComm.fileDescriptor, TCSETS2, &tio);
+        if (serialComm.verbose) logMessage(serialComm.errorState, In, serialComm.inBuffer, serialComm.inBuffer[PACKLEN_IDX], readAt);
+
+        setMarkParity(serialComm.fileDescriptor, true);
 		return;
     }
     else
     {
-        serialComm.head += bytesRead;
-
-        // After all bytes have been read in
-        if (serialComm.head >= MIN_PACK_LEN && serialComm.head >= serialComm.inBuffer[PACKLEN_IDX])
-        {
-            // Check for a good CS
-            if (!validateChecksum())
-            {
-                std::cout << "ERROR_BAD_CHECKSUM 0x";
-                printBuffer(serialComm.inBuffer, serialComm.inBuffer[PACKLEN_IDX]);
-                serialComm.errorState = BAD_CHECKSUM;
-            }
-
-            // Capture logs
-            else if (serialComm.verbose) logMessage(serialComm.errorState, In, serialComm.inBuffer, serialComm.inBuffer[PACKLEN_IDX]);
-            serialComm.mode = DONE;
-        }
+        busHealth.recordBytes(bytesRead);
+        serialComm.head = unstuffInput(serialComm, bytesRead);
+        commFrame(serialComm);
     }
 
     if (serialComm.errorState != NONE || serialComm.mode == DONE)
     {
-        struct termios2 tio;
+        // A bad checksum is expected when the UART dropped bytes, report the cause instead
+        if (checkLineCounters() && serialComm.errorState == BAD_CHECKSUM) serialComm.errorState = FIFO_OVERRUN;
+
         serialComm.mode = DONE;
         serialComm.head = 0;
 
-        ioctl(serialComm.fileDescriptor, TCGETS2, &tio);
-        tio.c_cflag |= PARODD;
-        ioctl(serialComm.fileDescriptor, TCSETS2, &tio);
+        setMarkParity(serialComm.fileDescriptor, true);
     }
 }
@@ -0,0 +1,72 @@
+#include "response_cache.h"
+#include "../logger/log.h"
+
+ResponseCache responseCache;
+
+void ResponseCache::enable(const Message* command, uint32_t ttlMs)
+{
+    if (!command) return;
+
+    Command& cached = m_commands[command];
+    cached.ttlNanos = uint64_t(ttlMs) * 1000000;
+}
+
+void ResponseCache::disable(const Message* command)
+{
+    m_commands.erase(command);
+}
+
+void ResponseCache::clear()
+{
+    for (std::pair<const Message* const, Command>& cached : m_commands)
+    {
+        cached.second.entries.clear();
+        cached.second.next = 0;
+    }
+}
+
+void ResponseCache::reset()
+{
+    m_commands.clear();
+    m_hits   = 0;
+    m_misses = 0;
+}
+
+ResponseCache::Entry* ResponseCache::find(Command& cached, const MessageInstance& command)
+{
+    for (Entry& entry : cached.entries)
+        if (!std::memcmp(entry.request, command.getData(), command.getDataSize())) return &entry;
+    return nullptr;
+}
+
+bool ResponseCache::lookup(const MessageInstance& command, MessageInstance* response)
+{
+    std::unordered_map<const Message*, Command>::iterator itr = m_commands.find(command.getSchema());
+    if (itr == m_commands.end()) return false;
+
+    Entry* entry = find(itr->second, command);
+    if (!entry || monotonicNanos() - entry->storedAt > itr->second.ttlNanos) {m_misses++; return false;}
+
+    m_hits++;
+    if (response) *response = entry->response;
+    return true;
+}
+
+void ResponseCache::store(const MessageInstance& command, const MessageInstance& response)
+{
+    std::unordered_map<const Message*, Command>::iterator itr = m_commands.find(command.getSchema());
+    if (itr == m_commands.end() || !response.isBound()) return;
+
+    Command& cached = itr->second;
+    Entry*   entry  = find(cached, command);
+    if (!entry)
+    {
+        if (int(cached.entries.size()) < MAX_CACHED_REQUESTS) {cached.entries.emplace_back(); entry = &cached.entries.back();}
+        else {entry = &cached.entries[cached.next]; cached.next = (cached.next + 1) % MAX_CACHED_REQUESTS;}
+
+        std::memcpy(entry->request, command.getData(), command.getDataSize());
+    }
+
+    entry->response = response;
+    entry->storedAt = monotonicNanos();
+}
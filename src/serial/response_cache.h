@@ -0,0 +1,66 @@
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include "../parser/msg_instance.h"
+
+#include <unordered_map>
+
+#define MAX_CACHED_REQUESTS 16     // distinct payloads remembered per command, oldest replaced first
+
+/**
+ * @brief The ResponseCache answers repeated read-only queries without touching
+ * the bus, for commands explicitly marked as cacheable:
+ *
+ *      responseCache.enable(table.findMessage("Version_Command"), 5000);  // fresh for 5 s
+ *      cmd.sendMessage(&rsp);      // on the bus
+ *      cmd.sendMessage(&rsp);      // answered from the cache, nothing sent
+ *
+ * Entries are keyed by the command (its search tag) and its data bytes, so the
+ * same query with other parameters goes to the bus. Only responses received
+ * without error are kept. Only enable it for commands without side effects,
+ * anything the base changes in between (e.g. status reports) is not seen until
+ * the entry expires. Not thread safe, like the rest of the engine.
+ */
+class ResponseCache
+{
+    public:
+        // Responses to `command` are reused for `ttlMs` milliseconds
+        void enable(const Message* command, uint32_t ttlMs);
+        void disable(const Message* command);       // also drops its entries
+        void clear();                               // drops every entry, commands stay cacheable
+        void reset();                               // drops every entry and command, counters back to 0
+
+        bool isEnabled(const Message* command) const { return !m_commands.empty() && m_commands.count(command); }
+
+        // Copies a fresh response to `command` into `response` (if not NULL)
+        // @return false if there is none
+        bool lookup(const MessageInstance& command, MessageInstance* response);
+        void store(const MessageInstance& command, const MessageInstance& response);
+
+        uint64_t getHits()   const { return m_hits;   }
+        uint64_t getMisses() const { return m_misses; }
+    private:
+        struct Entry
+        {
+            BYTE            request[MAX_DATA_LEN];
+            MessageInstance response;
+            uint64_t        storedAt;       // monotonicNanos()
+        };
+
+        struct Command
+        {
+            uint64_t           ttlNanos;
+            std::vector<Entry> entries;
+            int                next = 0;    // entry replaced when full
+        };
+
+        Entry* find(Command& cached, const MessageInstance& command);
+
+        std::unordered_map<const Message*, Command> m_commands;
+        uint64_t                                    m_hits   = 0;
+        uint64_t                                    m_misses = 0;
+};
+
+extern ResponseCache responseCache;
+
+#endif // RESPONSE_CACHE_H
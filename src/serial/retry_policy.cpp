@@ -0,0 +1,98 @@
+#include "retry_policy.h"
+#include "../logger/log.h"
+
+#include <cmath>
+
+RetryController commRetry;
+
+RetryController::RetryController()
+    : m_default(DEFAULT_RETRY_POLICY), m_random(uint32_t(monotonicNanos())), m_retries(0)
+{
+}
+
+void RetryController::setPolicy(const Message* command, const RetryPolicy& policy)
+{
+    if (command) m_policies[command] = policy;
+}
+
+void RetryController::clearPolicy(const Message* command)
+{
+    m_policies.erase(command);
+}
+
+void RetryController::reset()
+{
+    m_default = DEFAULT_RETRY_POLICY;
+    m_policies.clear();
+    m_budgets.clear();
+    m_retries = 0;
+}
+
+const RetryPolicy& RetryController::getPolicy(const Message* command) const
+{
+    std::unordered_map<const Message*, RetryPolicy>::const_iterator itr = m_policies.find(command);
+    return (itr != m_policies.end()) ? itr->second : m_default;
+}
+
+bool RetryController::isTransient(comm_error error)
+{
+    switch (error)
+    {
+        case BAD_CHECKSUM:
+        case TIMEOUT:
+        case EMPTY_READ:
+        case BAD_FRAME:
+        case IO_ERROR:
+        case FIFO_OVERRUN:
+            return true;
+        default:
+            return false;
+    }
+}
+
+int RetryController::prune(Budget& budget, const RetryPolicy& policy, uint64_t now)
+{
+    uint64_t window = uint64_t(policy.budgetWindowS) * 1000000000;
+    while (!budget.failures.empty() && now - budget.failures.front() > window)
+        budget.failures.pop_front();
+
+    return policy.errorBudget - int(budget.failures.size());
+}
+
+int RetryController::getBudgetLeft(const Message* command)
+{
+    const RetryPolicy& policy = getPolicy(command);
+    if (policy.errorBudget <= 0) return -1;
+
+    return std::max(prune(m_budgets[command], policy, monotonicNanos()), 0);
+}
+
+bool RetryController::onFailure(const Message* command, comm_error error, int attempt, uint32_t& delayMs)
+{
+    const RetryPolicy& policy = getPolicy(command);
+    if (!isTransient(error)) return false;
+
+    // Every transient failure counts against the budget, the last attempt's too,
+    // so a command failing on each call spends it even without retrying
+    bool budgetSpent = false;
+    if (policy.errorBudget > 0)
+    {
+        uint64_t now    = monotonicNanos();
+        Budget&  budget = m_budgets[command];
+        budget.failures.push_back(now);
+        budgetSpent = prune(budget, policy, now) < 0;
+
+        if (budgetSpent && !budget.reported)
+            std::cout << "ERROR: " << command->getMsgName() << " spent its error budget (" << policy.errorBudget << " failures in "
+                      << policy.budgetWindowS << "s), not retrying it\n";
+        budget.reported = budgetSpent;
+    }
+    if (budgetSpent || attempt >= policy.retries) return false;
+
+    double backoff = policy.backoffMs * std::pow(double(policy.backoffFactor), attempt);
+    delayMs = uint32_t(std::min(backoff, double(policy.maxBackoffMs)));
+    if (policy.jitterMs) delayMs += m_random() % (policy.jitterMs + 1);
+
+    m_retries++;
+    return true;
+}
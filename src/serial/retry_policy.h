@@ -0,0 +1,84 @@
+#ifndef RETRY_POLICY_H
+#define RETRY_POLICY_H
+
+#include "../parser/msg.h"
+
+#include <deque>
+#include <random>
+#include <unordered_map>
+
+/*
+ * How sendMessage() reacts to a failed exchange (TIMEOUT, BAD_CHECKSUM,
+ * BAD_FRAME, EMPTY_READ, IO_ERROR, FIFO_OVERRUN): the command is sent again after
+ *
+ *      min(backoffMs * backoffFactor^retry, maxBackoffMs) + random(0, jitterMs)
+ *
+ * up to `retries` times. Retrying is opt-in, as resending a command isn't safe
+ * on every device: the default policy has none, a script enables them for all
+ * its commands (setDefault()) or for some (setPolicy(), `retry` in a sequence).
+ * The error budget caps the failed attempts of one command within
+ * `budgetWindowS` seconds: once spent, that command fails on its first error
+ * again, so a dead device doesn't stall the script in retries.
+ */
+struct RetryPolicy
+{
+    int         retries;        // extra attempts after the first one, 0 disables retrying
+    uint32_t    backoffMs;      // wait before the first retry
+    float       backoffFactor;  // multiplies the wait after every retry
+    uint32_t    maxBackoffMs;
+    uint32_t    jitterMs;       // random extra wait, keeps rigs sharing a bus from retrying in lockstep
+    int         errorBudget;    // failed attempts allowed per command per window, 0 for no limit
+    uint32_t    budgetWindowS;
+};
+
+#define DEFAULT_RETRY_POLICY {0, 50, 2.0f, 1000, 20, 0, 60}   // no retries, backoff used once enabled
+
+/**
+ * @brief Retry policies (a default one and per command overrides) and the
+ * error budget bookkeeping, consulted by MessageInstance::sendMessage():
+ *
+ *      commRetry.setDefault({3, 100, 2.0f, 2000, 50, 0, 60});
+ *      commRetry.setPolicy(table.findMessage("Push Command"), {1, 20, 1.0f, 20, 0, 10, 60});
+ *
+ * Not thread safe, like the rest of the engine.
+ */
+class RetryController
+{
+    public:
+        RetryController();
+
+        void               setDefault(const RetryPolicy& policy)    { m_default = policy; }
+        const RetryPolicy& getDefault() const                       { return m_default;   }
+        void               setPolicy(const Message* command, const RetryPolicy& policy);
+        void               clearPolicy(const Message* command);
+        void               reset();     // DEFAULT_RETRY_POLICY, no overrides, budgets and counter cleared
+        const RetryPolicy& getPolicy(const Message* command) const;
+
+        // Errors worth another attempt (everything that may come from line noise or a busy base)
+        static bool isTransient(comm_error error);
+
+        // Records failed attempt number `attempt` (0 for the first send) of `command`
+        // @return true if it should be sent again after `delayMs`
+        bool onFailure(const Message* command, comm_error error, int attempt, uint32_t& delayMs);
+
+        uint64_t getRetries()                       const { return m_retries; }     // retries done, all commands
+        int      getBudgetLeft(const Message* command);                            // -1 when unlimited
+    private:
+        struct Budget
+        {
+            std::deque<uint64_t> failures;      // monotonicNanos() of failed attempts within the window
+            bool                 reported = false;
+        };
+
+        int  prune(Budget& budget, const RetryPolicy& policy, uint64_t now);
+
+        RetryPolicy                                     m_default;
+        std::unordered_map<const Message*, RetryPolicy> m_policies;
+        std::unordered_map<const Message*, Budget>      m_budgets;
+        std::minstd_rand                                m_random;
+        uint64_t                                        m_retries;
+};
+
+extern RetryController commRetry;
+
+#endif // RETRY_POLICY_H
@@ -0,0 +1,161 @@
+#include "serial_thread.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <windows.h>
+#else
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/mman.h>
+    #include <sys/resource.h>
+    #include <unistd.h>
+#endif
+
+SerialThread serialThread;
+
+bool SerialThread::start(const RealtimeOptions& options)
+{
+    if (m_running) return true;
+
+    m_stop  = false;
+    m_ready = false;
+    try {m_thread = std::thread(&SerialThread::loop, this, options);}
+    catch (const std::system_error& error) {std::cout << "ERROR: Serial thread not started: " << error.what() << '\n'; return false;}
+
+    // Settings are applied by the thread itself, wait for its report
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_wake.wait(lock, [this]() { return m_ready; });
+    m_running = true;
+
+    std::cout << "Serial thread: " << m_settings << '\n';
+    return true;
+}
+
+void SerialThread::stop()
+{
+    if (!m_running) return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    m_thread.join();
+    m_running = false;
+}
+
+void SerialThread::run(const std::function<void()>& job)
+{
+    if (!m_running || isCurrent()) {job(); return;}
+
+    std::lock_guard<std::mutex>  caller(m_callers);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_job  = &job;
+    m_done = false;
+    m_wake.notify_all();
+    m_wake.wait(lock, [this]() { return m_done; });
+}
+
+void SerialThread::loop(RealtimeOptions options)
+{
+    std::string settings = applyOptions(options);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_settings = settings;
+    m_ready    = true;
+    m_wake.notify_all();
+
+    while (true)
+    {
+        m_wake.wait(lock, [this]() { return m_stop || m_job; });
+        if (m_stop) return;
+
+        const std::function<void()>* job = m_job;
+        lock.unlock();
+        (*job)();
+        lock.lock();
+
+        m_job  = nullptr;
+        m_done = true;
+        m_wake.notify_all();
+    }
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+
+std::string SerialThread::applyOptions(const RealtimeOptions& options)
+{
+    std::string settings;
+
+    if (options.priority <= 0) settings = "normal priority";
+    else if (SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)) settings = "time critical priority";
+    else settings = "normal priority (time critical refused, error " + std::to_string(GetLastError()) + ")";
+
+    if (options.cpu >= 0)
+    {
+        if (options.cpu < 64 && SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << options.cpu)) settings += ", CPU " + std::to_string(options.cpu);
+        else settings += ", not pinned (CPU " + std::to_string(options.cpu) + " refused)";
+    }
+
+    if (options.lockMemory) settings += ", memory not locked (not supported on Windows)";
+    return settings;
+}
+
+#else
+
+// Touches the stack the engine will use, so locked memory covers it before the first exchange
+static void prefaultStack()
+{
+    volatile char stack[64 * 1024];
+    std::memset(const_cast<char*>(stack), 0, sizeof(stack));
+}
+
+std::string SerialThread::applyOptions(const RealtimeOptions& options)
+{
+    std::string settings;
+
+    // Priority
+    if (options.priority <= 0) settings = "normal scheduler";
+    else
+    {
+        struct sched_param param;
+        std::memset(&param, 0, sizeof(param));
+        param.sched_priority = std::min(std::max(options.priority, sched_get_priority_min(SCHED_FIFO)), sched_get_priority_max(SCHED_FIFO));
+
+        int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (!error) settings = "SCHED_FIFO priority " + std::to_string(param.sched_priority);
+        else        settings = std::string("normal scheduler (SCHED_FIFO refused: ") + strerror(error) + ", needs root or CAP_SYS_NICE)";
+    }
+
+    // Core
+    if (options.cpu >= 0)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(options.cpu, &cpus);
+
+        int error = (options.cpu < CPU_SETSIZE) ? pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) : EINVAL;
+        if (!error) settings += ", CPU " + std::to_string(options.cpu);
+        else        settings += ", not pinned (CPU " + std::to_string(options.cpu) + ": " + strerror(error) + ")";
+    }
+
+    // Memory: future mappings only when the lock limit cannot be hit, allocations would fail past it otherwise
+    if (options.lockMemory)
+    {
+        struct rlimit limit;
+        bool unlimited = geteuid() == 0 || (getrlimit(RLIMIT_MEMLOCK, &limit) == 0 && limit.rlim_cur == RLIM_INFINITY);
+        int  flags     = unlimited ? (MCL_CURRENT | MCL_FUTURE) : MCL_CURRENT;
+
+        if (mlockall(flags) == 0)
+        {
+            prefaultStack();
+            settings += unlimited ? ", memory locked" : ", memory locked (current pages only, RLIMIT_MEMLOCK is limited)";
+        }
+        else settings += std::string(", memory not locked (") + strerror(errno) + ")";
+    }
+    return settings;
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef SERIAL_THREAD_H
+#define SERIAL_THREAD_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// How the serial thread is scheduled, every setting falls back (with a message) when not permitted
+struct RealtimeOptions
+{
+    int  priority;      // SCHED_FIFO priority 1-99 (Linux), time critical priority (Windows), 0 keeps the normal scheduler
+    int  cpu;           // core to pin the thread to, -1 for any
+    bool lockMemory;    // mlockall() so the engine never waits on a page fault (Linux)
+};
+
+/**
+ * @brief The SerialThread runs every exchange (sendMessage()) on one dedicated
+ * thread, so its scheduling can be raised without touching the script's
+ * threads. The timing sensitive part of an exchange, switching from MARK to
+ * SPACE parity ~1 ms after the first byte, then no longer depends on how
+ * busy the machine is.
+ *
+ * Started by initComm() when SERIAL_THREAD is set in lf_comm.h, sendMessage()
+ * then hands its work over and waits for it: the send, its retries and the
+ * decoding of the response into the caller's MessageInstance, so the shared
+ * serialComm buffers are never read by one caller while another one's exchange
+ * runs. Callers are served one at a time.
+ */
+class SerialThread
+{
+    public:
+        SerialThread() {}
+        ~SerialThread() { stop(); }
+
+        SerialThread(const SerialThread&)            = delete;
+        SerialThread& operator=(const SerialThread&) = delete;
+
+        // Starts the thread and applies `options` from inside it, prints the settings in effect
+        // @return false if the thread could not be started (settings that fail only print a warning)
+        bool start(const RealtimeOptions& options);
+        void stop();
+
+        bool isRunning() const { return m_running; }
+        bool isCurrent() const { return m_running && std::this_thread::get_id() == m_thread.get_id(); }
+
+        // Runs `job` on the serial thread and waits for it to finish (runs it here if not started)
+        void run(const std::function<void()>& job);
+
+        const std::string& getSettings() const { return m_settings; }   // as printed by start()
+    private:
+        void loop(RealtimeOptions options);
+        std::string applyOptions(const RealtimeOptions& options);       // on the serial thread
+
+        std::thread                 m_thread;
+        std::atomic<bool>           m_running{false};   // read by every caller of run()
+        std::string                 m_settings;
+
+        std::mutex                  m_callers;      // one run() at a time
+        std::mutex                  m_mutex;
+        std::condition_variable     m_wake;
+        const std::function<void()>* m_job    = nullptr;
+        bool                        m_done    = false;
+        bool                        m_ready   = false;
+        bool                        m_stop    = false;
+};
+
+extern SerialThread serialThread;
+
+#endif // SERIAL_THREAD_H
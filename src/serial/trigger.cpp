@@ -0,0 +1,165 @@
+#include "trigger.h"
+#include "lf_comm.h"
+
+TriggerEngine triggers;
+
+/* Trigger ===================================================================================== */
+
+Trigger::Trigger(const Message* schema)
+    : m_schema(schema), m_target(0), m_source(0), m_id(0), m_valid(schema != nullptr), m_rising(false), m_masks(0), m_ranges(0)
+{
+    if (!schema) {std::cout << "ERROR: Trigger built on an unknown message..." << '\n'; return;}
+
+    const BYTE* header = schema->getHeader();
+    m_target = header[TARGET_IDX];
+    m_source = header[SOURCE_IDX];
+    m_id     = header[MSG_ID_IDX];
+}
+
+const MessageField* Trigger::resolve(const std::string& name)
+{
+    const MessageField* field = m_schema ? m_schema->findMessageField(name) : nullptr;
+    if (!field) {m_valid = false; return nullptr;}
+
+    if (field->getSize() > 8 || field->getTypeEnum() == MessageField::string || field->getTypeEnum() == MessageField::bytes || field->getTypeEnum() == MessageField::words)
+    {
+        std::cout << "ERROR: Trigger on '" << name << "' needs an integer field..." << '\n';
+        m_valid = false;
+        return nullptr;
+    }
+    return field;
+}
+
+Trigger& Trigger::field(const std::string& name, uint64_t mask, uint64_t value)
+{
+    const MessageField* field = resolve(name);
+    if (!field) return *this;
+
+    // Big endian in the packet: byte i holds bits 8*(size-1-i) and up
+    for (int i = 0; i < field->getSize(); i++)
+    {
+        int  shift    = 8 * (field->getSize() - 1 - i);
+        BYTE byteMask = BYTE(mask >> shift);
+        if (!byteMask) continue;
+
+        raw(field->getOffset() + i, byteMask, BYTE(value >> shift) & byteMask);
+    }
+    return *this;
+}
+
+Trigger& Trigger::equals(const std::string& name, uint64_t value)
+{
+    return field(name, ~uint64_t(0), value);
+}
+
+Trigger& Trigger::range(const std::string& name, uint64_t min, uint64_t max)
+{
+    const MessageField* field = resolve(name);
+    if (!field) return *this;
+    if (m_ranges == MAX_TRIGGER_PREDICATES) {std::cout << "ERROR: More than " << MAX_TRIGGER_PREDICATES << " range tests in a trigger..." << '\n'; m_valid = false; return *this;}
+
+    m_rangeTests[m_ranges++] = {DATA_IDX + field->getOffset(), field->getSize(), min, max};
+    return *this;
+}
+
+Trigger& Trigger::atLeast(const std::string& name, uint64_t value) { return range(name, value, ~uint64_t(0)); }
+Trigger& Trigger::atMost (const std::string& name, uint64_t value) { return range(name, 0, value); }
+
+Trigger& Trigger::bit(const BitMask& mask, bool set)
+{
+    if (!mask.isValid()) {m_valid = false; return *this;}
+    return raw(mask.offset, mask.mask, set ? mask.mask : 0);
+}
+
+Trigger& Trigger::raw(int dataOffset, BYTE mask, BYTE value)
+{
+    if (!m_schema || dataOffset < 0 || dataOffset >= m_schema->getDataSize()) {std::cout << "ERROR: Trigger offset " << dataOffset << " out of range..." << '\n'; m_valid = false; return *this;}
+    if (m_masks == MAX_TRIGGER_PREDICATES) {std::cout << "ERROR: More than " << MAX_TRIGGER_PREDICATES << " mask tests in a trigger..." << '\n'; m_valid = false; return *this;}
+
+    m_maskTests[m_masks++] = {DATA_IDX + dataOffset, mask, value};
+    return *this;
+}
+
+bool Trigger::matches(const BYTE* packet) const
+{
+    // Shorter packet than the schema: offsets may point past its end
+    if (packet[PACKLEN_IDX] != m_schema->getPackLen()) return false;
+
+    for (int i = 0; i < m_masks; i++)
+        if ((packet[m_maskTests[i].offset] & m_maskTests[i].mask) != m_maskTests[i].value) return false;
+
+    for (int i = 0; i < m_ranges; i++)
+    {
+        uint64_t value = loadBigEndian(packet + m_rangeTests[i].offset, m_rangeTests[i].size);
+        if (value < m_rangeTests[i].min || value > m_rangeTests[i].max) return false;
+    }
+    return true;
+}
+
+/* TriggerEngine =============================================================================== */
+
+int TriggerEngine::add(const Trigger& trigger, TriggerCallback callback)
+{
+    if (!trigger.isValid() || !callback) {std::cout << "ERROR: Invalid trigger not added..." << '\n'; return 0;}
+
+    m_entries.push_back({m_nextId, trigger, callback, false, 0});
+    return m_nextId++;
+}
+
+void TriggerEngine::remove(int id)
+{
+    for (std::vector<Entry>::iterator itr = m_entries.begin(); itr != m_entries.end(); itr++)
+        if (itr->id == id) {m_entries.erase(itr); return;}
+}
+
+uint64_t TriggerEngine::getFireCount(int id) const
+{
+    for (const Entry& entry : m_entries)
+        if (entry.id == id) return entry.fired;
+    return 0;
+}
+
+void TriggerEngine::evaluate(const BYTE* packet, uint64_t timestamp)
+{
+    for (Entry& entry : m_entries)
+    {
+        const Trigger& trigger = entry.trigger;
+        if (packet[TARGET_IDX] != trigger.m_target || packet[SOURCE_IDX] != trigger.m_source || packet[MSG_ID_IDX] != trigger.m_id) continue;
+
+        bool matched  = trigger.matches(packet);
+        bool fire     = matched && !(trigger.m_rising && entry.matched);
+        entry.matched = matched;
+        if (!fire) continue;
+
+        entry.fired++;
+        if (m_queued == m_queue.size()) m_queue.emplace_back();
+
+        Fired& fired    = m_queue[m_queued++];
+        fired.id        = entry.id;
+        fired.timestamp = timestamp;
+        std::copy(packet, packet + packet[PACKLEN_IDX], fired.packet);
+    }
+}
+
+void TriggerEngine::dispatch()
+{
+    if (!m_queued) return;
+
+    // A callback may send (queuing and dispatching more) or add/remove triggers: take the queue first
+    std::vector<Fired> queue;
+    queue.swap(m_queue);
+    size_t queued = m_queued;
+    m_queued = 0;
+
+    for (size_t i = 0; i < queued; i++)
+    {
+        TriggerCallback callback;
+        for (const Entry& entry : m_entries)
+            if (entry.id == queue[i].id) {callback = entry.callback; break;}
+
+        if (callback) callback(queue[i].packet, queue[i].timestamp);
+    }
+
+    // Give the buffer back unless a callback started a new one
+    if (m_queue.empty()) m_queue.swap(queue);
+}
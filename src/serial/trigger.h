@@ -0,0 +1,118 @@
+#ifndef TRIGGER_H
+#define TRIGGER_H
+
+#include "../parser/msg_instance.h"
+
+#include <functional>
+
+#define MAX_TRIGGER_PREDICATES 16
+
+// Called from the framer with the raw packet (header first, checksum verified) and monotonicNanos() of its arrival
+typedef std::function<void(const BYTE* packet, uint64_t timestamp)> TriggerCallback;
+
+/**
+ * @brief A Trigger is a condition on one message, compiled into byte offset
+ * and mask tests on the raw packet, so it is checked without decoding:
+ *
+ *      const Message* push = table.findMessage("Push_Report");
+ *      triggers.add(Trigger(push).atLeast("actual_rpm", 1000), [](const BYTE*, uint64_t) { ... });
+ *      triggers.add(Trigger(push).bit(push->getBitMask("ngstat0", 3)).rising(), onFault);
+ *
+ * Every condition must hold for the trigger to fire. Names are resolved when
+ * the trigger is built, an invalid field/bit prints an ERROR and makes the
+ * trigger invalid (TriggerEngine::add() then refuses it).
+ */
+class Trigger
+{
+    public:
+        explicit Trigger(const Message* schema);
+
+        Trigger& field(const std::string& name, uint64_t mask, uint64_t value);    // (field & mask) == value
+        Trigger& equals(const std::string& name, uint64_t value);                  // field == value
+        Trigger& atLeast(const std::string& name, uint64_t value);                 // field >= value (unsigned)
+        Trigger& atMost(const std::string& name, uint64_t value);                  // field <= value (unsigned)
+        Trigger& bit(const BitMask& mask, bool set = true);
+        Trigger& raw(int dataOffset, BYTE mask, BYTE value);                       // (data[dataOffset] & mask) == value
+
+        // Fires only on the first matching packet after a non matching one (default: every matching packet)
+        Trigger& rising()                   { m_rising = true; return *this; }
+
+        bool            isValid()   const   { return m_valid; }
+        const Message*  getSchema() const   { return m_schema; }
+
+        // True if `packet` (a full packet with a good checksum) satisfies every condition
+        bool matches(const BYTE* packet) const;
+    private:
+        struct MaskTest  { int offset; BYTE mask; BYTE value; };                   // offsets into the packet
+        struct RangeTest { int offset; int size; uint64_t min; uint64_t max; };
+
+        const MessageField* resolve(const std::string& name);
+        Trigger&            range(const std::string& name, uint64_t min, uint64_t max);
+
+        const Message*  m_schema;
+        BYTE            m_target, m_source, m_id;
+        bool            m_valid;
+        bool            m_rising;
+        int             m_masks, m_ranges;
+        MaskTest        m_maskTests[MAX_TRIGGER_PREDICATES];
+        RangeTest       m_rangeTests[MAX_TRIGGER_PREDICATES];
+
+        friend class TriggerEngine;
+};
+
+/**
+ * @brief The TriggerEngine checks every packet completed by the framer (commRead())
+ * against the registered triggers, right after its checksum is verified and
+ * before handleResponse() decodes anything.
+ *
+ * Matching is done while framing, the callbacks are not: each firing trigger
+ * queues a copy of the packet, and dispatch() runs the queue once the exchange
+ * is over and its response decoded (at the end of sendMessage() and
+ * UringComm::finish()). A callback may therefore send, and gets a packet no
+ * later exchange can overwrite. Callbacks run on the thread that called
+ * sendMessage(), keep them short. Not thread safe, like the rest of the engine.
+ */
+class TriggerEngine
+{
+    public:
+        TriggerEngine() : m_nextId(1), m_queued(0) {}
+
+        // @return an id for remove()/getFireCount(), 0 if the trigger is invalid
+        int  add(const Trigger& trigger, TriggerCallback callback);
+        void remove(int id);            // a queued call of a removed trigger is dropped
+        void clear()                    { m_entries.clear(); m_queue.clear(); m_queued = 0; }
+
+        bool     isActive() const       { return !m_entries.empty(); }
+        uint64_t getFireCount(int id) const;
+
+        // Called by the framer for every good packet, queues the triggers it fires
+        void evaluate(const BYTE* packet, uint64_t timestamp);
+
+        // Runs the queued callbacks, in the order they fired
+        void dispatch();
+    private:
+        struct Entry
+        {
+            int             id;
+            Trigger         trigger;
+            TriggerCallback callback;
+            bool            matched;    // last packet of this message matched (for rising())
+            uint64_t        fired;
+        };
+
+        struct Fired
+        {
+            int         id;
+            uint64_t    timestamp;
+            BYTE        packet[0x100];  // PACKLEN_IDX is a byte, no packet is longer
+        };
+
+        int                 m_nextId;
+        std::vector<Entry>  m_entries;
+        std::vector<Fired>  m_queue;    // reused, keeps its capacity
+        size_t              m_queued;   // entries of m_queue in use
+};
+
+extern TriggerEngine triggers;
+
+#endif // TRIGGER_H
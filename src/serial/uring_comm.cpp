@@ -0,0 +1,367 @@
+#include "uring_comm.h"
+
+#if defined(__linux__)
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <cstring>
+
+#define PARITY_DELAY_NS 1000000     // same 1 ms as commWrite()
+
+static uint64_t makeUserData(int port, int kind)  { return (uint64_t(port) << 8) | uint64_t(kind); }
+
+static int uringSetup(unsigned entries, io_uring_params* params)
+{
+    return int(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int uringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    return int(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+UringComm::UringComm()
+    : m_ringFd(-1), m_ringMem(MAP_FAILED), m_ringSize(0), m_sqes(nullptr), m_sqesSize(0),
+      m_sqHead(nullptr), m_sqTail(nullptr), m_sqMask(nullptr), m_sqArray(nullptr),
+      m_cqHead(nullptr), m_cqTail(nullptr), m_cqMask(nullptr), m_cqes(nullptr),
+      m_entries(0), m_sqLocalTail(0), m_busy(0)
+{
+}
+
+UringComm::~UringComm()
+{
+    close();
+}
+
+bool UringComm::open(unsigned entries)
+{
+    if (m_ringFd >= 0) return true;
+
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    m_ringFd = uringSetup(entries, &params);
+    if (m_ringFd < 0) {std::cout << "ERROR: io_uring_setup() failed with error " << strerror(errno) << '\n'; return false;}
+
+    // Single mmap for both rings (5.4) and reads/writes at the current position (5.6)
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_RW_CUR_POS))
+    {
+        std::cout << "ERROR: io_uring is too old for UringComm (Linux 5.6 or newer needed)...\n";
+        closeRing();
+        return false;
+    }
+
+    size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cqSize = params.cq_off.cqes  + params.cq_entries * sizeof(io_uring_cqe);
+    m_ringSize    = std::max(sqSize, cqSize);
+    m_sqesSize    = params.sq_entries * sizeof(io_uring_sqe);
+
+    m_ringMem = mmap(nullptr, m_ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQ_RING);
+    void* sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQES);
+    if (m_ringMem == MAP_FAILED || sqes == MAP_FAILED)
+    {
+        std::cout << "ERROR: io_uring mmap() failed with error " << strerror(errno) << '\n';
+        if (sqes != MAP_FAILED) munmap(sqes, m_sqesSize);
+        closeRing();
+        return false;
+    }
+
+    char* ring    = static_cast<char*>(m_ringMem);
+    m_sqes        = static_cast<io_uring_sqe*>(sqes);
+    m_sqHead      = reinterpret_cast<unsigned*>(ring + params.sq_off.head);
+    m_sqTail      = reinterpret_cast<unsigned*>(ring + params.sq_off.tail);
+    m_sqMask      = reinterpret_cast<unsigned*>(ring + params.sq_off.ring_mask);
+    m_sqArray     = reinterpret_cast<unsigned*>(ring + params.sq_off.array);
+    m_cqHead      = reinterpret_cast<unsigned*>(ring + params.cq_off.head);
+    m_cqTail      = reinterpret_cast<unsigned*>(ring + params.cq_off.tail);
+    m_cqMask      = reinterpret_cast<unsigned*>(ring + params.cq_off.ring_mask);
+    m_cqes        = reinterpret_cast<io_uring_cqe*>(ring + params.cq_off.cqes);
+    m_entries     = params.sq_entries;
+    m_sqLocalTail = *m_sqTail;
+    return true;
+}
+
+void UringComm::close()
+{
+    closeRing();
+
+    for (const std::unique_ptr<Port>& port : m_ports)
+        ::close(int(port->comm.fileDescriptor));
+    m_ports.clear();
+    m_busy = 0;
+}
+
+void UringComm::closeRing()
+{
+    // Closing the ring cancels what is still in flight, the kernel stops using the Ports
+    if (m_sqes)                  munmap(m_sqes, m_sqesSize);
+    if (m_ringMem != MAP_FAILED) munmap(m_ringMem, m_ringSize);
+    if (m_ringFd >= 0)           ::close(m_ringFd);
+
+    m_sqes    = nullptr;
+    m_ringMem = MAP_FAILED;
+    m_ringFd  = -1;
+}
+
+int UringComm::addPort(const std::string& device, bool verbose)
+{
+    if (!open()) return -1;
+
+    // VMIN 1: a read completes with the first bytes in, the linked timeout takes the place of VTIME
+    int fd = openPort(device, 1, 0);
+    if (fd < 0) return -1;
+
+    std::unique_ptr<Port> port(new Port());
+    port->comm.fileDescriptor  = uint64_t(fd);
+    port->comm.verbose         = verbose;
+    port->comm.timeoutDuration = PACKET_TIMEOUT_S;
+    port->comm.mode            = DONE;
+    port->readTimeout.tv_sec   = TIMEOUT_MS / 1000;
+    port->readTimeout.tv_nsec  = (TIMEOUT_MS % 1000) * 1000000LL;
+    port->parityDelay.tv_nsec  = PARITY_DELAY_NS;
+
+    m_ports.push_back(std::move(port));
+    return int(m_ports.size()) - 1;
+}
+
+bool UringComm::start(int port, const MessageInstance& command)
+{
+    if (port < 0 || port >= getPorts()) {std::cout << "ERROR: UringComm has no port " << port << "...\n"; return false;}
+    if (m_ports[port]->busy)             {std::cout << "ERROR: UringComm port " << port << " is still busy...\n"; return false;}
+    if (!open()) return false;          // closed by a ring error in run()
+
+    comm_t& comm = m_ports[port]->comm;
+    std::vector<uint8_t> msgBytes = command.getMessageBuffer();
+    std::memcpy(comm.outBuffer, msgBytes.data(), msgBytes.size());
+
+    comm.response   = 1;
+    comm.mode       = WRITING;
+    comm.head       = 0;
+    comm.errorState = NONE;
+
+    m_ports[port]->busy = true;
+    m_busy++;
+
+    submitWrite(port);
+    return true;
+}
+
+void UringComm::run()
+{
+    while (m_busy > 0)
+    {
+        if (submit(1)) {reap(); continue;}
+
+        // The ring itself failed: nothing in flight can complete anymore. Tear it down first so no
+        // read can still land in a Port's buffers once its exchange is over (the next start() reopens it)
+        closeRing();
+        for (const std::unique_ptr<Port>& port : m_ports)
+            if (port->busy) endExchange(*port, IO_ERROR);
+        return;
+    }
+
+    // Linked timeouts cancelled by their read may have completed too, drop them
+    reap();
+}
+
+comm_error UringComm::finish(int port, MessageInstance* response)
+{
+    if (port < 0 || port >= getPorts()) {std::cout << "ERROR: UringComm has no port " << port << "...\n"; return IO_ERROR;}
+    if (m_ports[port]->busy)             {std::cout << "ERROR: UringComm port " << port << " is still busy, call run() first...\n"; return IO_ERROR;}
+
+    const comm_t& comm = m_ports[port]->comm;
+    if (comm.errorState != NONE) return comm.errorState;
+
+    comm_error error = handleResponse(response, comm);
+    triggers.dispatch();    // fired by any port during run(), see TriggerEngine
+    return error;
+}
+
+/* Ring ======================================================================================== */
+
+io_uring_sqe* UringComm::getSqe()
+{
+    // Full: hand what is queued to the kernel first
+    if (m_sqLocalTail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_entries) submit(0);
+
+    unsigned      index = m_sqLocalTail & *m_sqMask;
+    io_uring_sqe* sqe   = &m_sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+
+    m_sqArray[index] = index;
+    m_sqLocalTail++;
+    return sqe;
+}
+
+bool UringComm::submit(unsigned waitFor)
+{
+    __atomic_store_n(m_sqTail, m_sqLocalTail, __ATOMIC_RELEASE);
+    unsigned toSubmit = m_sqLocalTail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+
+    if (uringEnter(m_ringFd, toSubmit, waitFor, waitFor ? IORING_ENTER_GETEVENTS : 0) >= 0) return true;
+    if (errno == EINTR || errno == EAGAIN || errno == EBUSY) return true;      // reap and try again
+
+    std::cout << "ERROR: io_uring_enter() failed with error " << strerror(errno) << '\n';
+    return false;
+}
+
+void UringComm::reap()
+{
+    unsigned head = *m_cqHead;
+    while (head != __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE))
+    {
+        io_uring_cqe cqe = m_cqes[head & *m_cqMask];
+        __atomic_store_n(m_cqHead, ++head, __ATOMIC_RELEASE);
+        complete(cqe);
+    }
+}
+
+void UringComm::submitWrite(int port)
+{
+    // First byte alone with MARK parity, then the rest with SPACE (see commWrite())
+    comm_t&       comm = m_ports[port]->comm;
+    io_uring_sqe* sqe  = getSqe();
+    sqe->opcode    = IORING_OP_WRITE;
+    sqe->fd        = int(comm.fileDescriptor);
+    sqe->addr      = uint64_t(uintptr_t(&comm.outBuffer[comm.head]));
+    sqe->len       = comm.head ? (comm.outBuffer[PACKLEN_IDX] - comm.head) : 1;
+    sqe->off       = uint64_t(-1);      // current position, a tty has no offset
+    sqe->user_data = makeUserData(port, OP_WRITE);
+}
+
+void UringComm::submitRead(int port)
+{
+    Port&         state = *m_ports[port];
+    io_uring_sqe* sqe   = getSqe();
+    sqe->opcode    = IORING_OP_READ;
+    sqe->fd        = int(state.comm.fileDescriptor);
+    sqe->addr      = uint64_t(uintptr_t(&state.comm.inBuffer[state.comm.head]));
+    sqe->len       = sizeof(state.comm.inBuffer) - state.comm.head;
+    sqe->off       = uint64_t(-1);
+    sqe->flags     = IOSQE_IO_LINK;
+    sqe->user_data = makeUserData(port, OP_READ);
+
+    // Cancels the read if no byte came within TIMEOUT_MS
+    io_uring_sqe* timeout = getSqe();
+    timeout->opcode    = IORING_OP_LINK_TIMEOUT;
+    timeout->fd        = -1;
+    timeout->addr      = uint64_t(uintptr_t(&state.readTimeout));
+    timeout->len       = 1;
+    timeout->user_data = makeUserData(port, OP_LINK_TIMEOUT);
+}
+
+void UringComm::submitDelay(int port)
+{
+    io_uring_sqe* sqe = getSqe();
+    sqe->opcode    = IORING_OP_TIMEOUT;
+    sqe->fd        = -1;
+    sqe->addr      = uint64_t(uintptr_t(&m_ports[port]->parityDelay));
+    sqe->len       = 1;
+    sqe->user_data = makeUserData(port, OP_PARITY_DELAY);
+}
+
+/* Port state machines ========================================================================= */
+
+void UringComm::complete(const io_uring_cqe& cqe)
+{
+    int port = int(cqe.user_data >> 8);
+    if (port >= getPorts() || !m_ports[port]->busy) return;
+
+    switch (int(cqe.user_data & 0xFF))
+    {
+        case OP_WRITE:
+            onWrite(port, cqe.res);
+            break;
+        case OP_READ:
+            onRead(port, cqe.res);
+            break;
+        case OP_PARITY_DELAY:
+            // Set 9th data bit to 0, it stays set for the read (see commWrite())
+            setMarkParity(int(m_ports[port]->comm.fileDescriptor), false);
+            submitWrite(port);
+            break;
+        default:    // OP_LINK_TIMEOUT, its read completes too and handles both outcomes
+            break;
+    }
+}
+
+void UringComm::onWrite(int port, int result)
+{
+    Port&   state = *m_ports[port];
+    comm_t& comm  = state.comm;
+
+    if (result < 0)  {std::cout << "ERROR: bad write in interrupt\nerrorno: " << strerror(-result) << '\n'; endExchange(state, IO_ERROR); return;}
+    if (result == 0) {std::cout << "ERROR: UringComm wrote 0 bytes\n"; endExchange(state, IO_ERROR); return;}
+
+    comm.head += result;
+
+    // After writing the first byte: wait for it to leave before switching parity
+    if (comm.head == 1)
+    {
+        comm.txTimestamp = monotonicNanos();
+        if (comm.verbose) logMessage(comm.errorState, Out, comm.outBuffer, comm.outBuffer[PACKLEN_IDX], comm.txTimestamp);
+        submitDelay(port);
+    }
+    // After writing all bytes
+    else if (comm.head >= comm.outBuffer[PACKLEN_IDX])
+    {
+        comm.mode = WAITING_FOR_MARK;
+        comm.head = 0;
+        submitRead(port);
+    }
+    else
+        submitWrite(port);
+}
+
+void UringComm::onRead(int port, int result)
+{
+    Port&    state  = *m_ports[port];
+    comm_t&  comm   = state.comm;
+    uint64_t readAt = monotonicNanos();
+
+    // Cancelled by the linked timeout (-EINTR when the read was blocked in an io_uring worker)
+    if (result == -ECANCELED || result == -EINTR)
+    {
+        if (comm.verbose) logMessage(TIMEOUT, In, comm.inBuffer, comm.inBuffer[PACKLEN_IDX], readAt);
+        endExchange(state, TIMEOUT);
+        return;
+    }
+    if (result < 0)
+    {
+        std::cout << "ERROR: bad read \nerrorno: " << strerror(-result) << '\n';
+        if (comm.verbose) logMessage(IO_ERROR, In, comm.inBuffer, comm.inBuffer[PACKLEN_IDX], readAt);
+        endExchange(state, IO_ERROR);
+        return;
+    }
+    if (result == 0)    // hang up, VMIN 1 never returns empty otherwise
+    {
+        if (comm.verbose) logMessage(EMPTY_READ, In, comm.inBuffer, comm.inBuffer[PACKLEN_IDX], readAt);
+        endExchange(state, EMPTY_READ);
+        return;
+    }
+
+    if (comm.head == 0) {comm.rxTimestamp = readAt; comm.marked = false; comm.sum = 0; comm.summed = 0;}
+
+    busHealth.recordBytes(result);
+    comm.mode = READING;
+    comm.head = unstuffInput(comm, result);
+    commFrame(comm);
+
+    if (comm.errorState != NONE || comm.mode == DONE) endExchange(state, comm.errorState);
+    else                                              submitRead(port);
+}
+
+void UringComm::endExchange(Port& port, comm_error error)
+{
+    port.comm.errorState = error;
+    port.comm.mode       = DONE;
+    port.comm.head       = 0;
+    setMarkParity(int(port.comm.fileDescriptor), true);
+
+    port.busy = false;
+    m_busy--;
+    busHealth.recordExchange(error);
+}
+
+#endif // __linux__
@@ -0,0 +1,115 @@
+#ifndef URING_COMM_H
+#define URING_COMM_H
+
+#include "lf_comm.h"
+
+#if defined(__linux__)
+
+#include <linux/time_types.h>
+#include <memory>
+
+#define URING_ENTRIES 256     // submission queue size, 3 per port in flight at most (read + linked timeout, or a write)
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/**
+ * @brief UringComm drives exchanges on many serial ports at once from one thread,
+ * for a host talking to several bases (Linux 5.6+, no library needed).
+ *
+ * Every port keeps its own comm_t and goes through the same states as serialComm
+ * (WRITING, WAITING_FOR_MARK, READING, DONE) with the same framing, logs and
+ * triggers (commFrame()). Instead of a blocking read()/write() per port, the reads
+ * and writes of every port are submitted to one io_uring, and each completion moves
+ * its port's state machine along. A read is linked to a TIMEOUT_MS timeout
+ * (IORING_OP_LINK_TIMEOUT): the ring cancels it if no byte came in time and the
+ * exchange ends with TIMEOUT, like a VTIME timeout on the main port.
+ *
+ *      UringComm ring;
+ *      int left = ring.addPort("/dev/ttyUSB0"), right = ring.addPort("/dev/ttyUSB1");
+ *      ring.start(left, cmd);
+ *      ring.start(right, cmd);
+ *      ring.run();                                     // until both exchanges are DONE
+ *      comm_error error = ring.finish(left, &rsp);     // like sendMessage(): NONE and `rsp` filled
+ *
+ * Exchanges are not retried (see RetryController, a script can start() again), the response
+ * cache and the serial thread only apply to sendMessage(). Not thread safe.
+ */
+class UringComm
+{
+    public:
+        UringComm();
+        ~UringComm();
+
+        // Sets up the ring (done by the first addPort())
+        // @return false if io_uring is not available (kernel < 5.6, kernel.io_uring_disabled, seccomp)
+        bool open(unsigned entries = URING_ENTRIES);
+        void close();                                   // closes the ring and every port
+
+        // Opens and configures `device` like openComm(), `verbose` logs its exchanges like -v
+        // @return the port's index, -1 on failure
+        int addPort(const std::string& device, bool verbose = false);
+        int getPorts() const                { return int(m_ports.size()); }
+
+        // Queues `command` on `port`, the exchange advances in run()
+        // @return false if the port is unknown or still busy, or the ring can't be set up again after a ring error
+        bool start(int port, const MessageInstance& command);
+
+        // Submits and processes completions until every started exchange is DONE
+        // A ring error closes the ring and ends the busy exchanges with IO_ERROR
+        void run();
+
+        // Result of the last exchange on `port`, binds `response` (if not NULL) like sendMessage()
+        comm_error finish(int port, MessageInstance* response);
+
+        const comm_t& getComm(int port) const { return m_ports[port]->comm; }
+    private:
+        enum OpKind { OP_WRITE, OP_READ, OP_LINK_TIMEOUT, OP_PARITY_DELAY };
+
+        struct Port
+        {
+            comm_t              comm;
+            bool                busy;           // started and not DONE yet
+            __kernel_timespec   readTimeout;    // TIMEOUT_MS, read by the kernel when the linked timeout is submitted
+            __kernel_timespec   parityDelay;    // 1 ms, lets the MARK byte leave before switching to SPACE
+        };
+
+        void          closeRing();                  // cancels everything in flight, the ports stay open
+        io_uring_sqe* getSqe();
+        bool          submit(unsigned waitFor);     // io_uring_enter(), false on a ring error
+        void          reap();
+        void          submitWrite(int port);
+        void          submitRead(int port);
+        void          submitDelay(int port);
+        void          complete(const io_uring_cqe& cqe);
+        void          endExchange(Port& port, comm_error error);
+
+        void          onWrite(int port, int result);
+        void          onRead(int port, int result);
+
+        int             m_ringFd;
+        void*           m_ringMem;          // SQ and CQ rings (IORING_FEAT_SINGLE_MMAP)
+        size_t          m_ringSize;
+        io_uring_sqe*   m_sqes;
+        size_t          m_sqesSize;
+
+        // Shared with the kernel
+        unsigned*       m_sqHead;
+        unsigned*       m_sqTail;
+        unsigned*       m_sqMask;
+        unsigned*       m_sqArray;
+        unsigned*       m_cqHead;
+        unsigned*       m_cqTail;
+        unsigned*       m_cqMask;
+        io_uring_cqe*   m_cqes;
+
+        unsigned        m_entries;
+        unsigned        m_sqLocalTail;      // past the last SQE filled, published to m_sqTail by submit()
+        int             m_busy;             // ports with an exchange not DONE
+
+        std::vector<std::unique_ptr<Port>> m_ports;     // not moved while the kernel writes into them
+};
+
+#endif // __linux__
+
+#endif // URING_COMM_H
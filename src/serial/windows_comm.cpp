@@ -36,15 +36,22 @@ bool processInput(int& argc, char **&argv)
 }
 
 bool initComm(int& argc, char **&argv)
+{
+        if (!processInput(argc, argv)) return false;
+        if (!openComm(usbFile))         return false;
+
+        if (SERIAL_THREAD) serialThread.start({SERIAL_THREAD_PRIORITY, SERIAL_THREAD_CPU, SERIAL_THREAD_MLOCK});
+        return true;
+}
+
+bool openComm(const std::string& device)
 {
         HANDLE hCom;
         DCB dcb = {0};
         COMMTIMEOUTS timeouts = {0};
 
-        if (!processInput(argc, argv)) return false;
-
         // Open Serial Port
-        hCom = CreateFile(usbFile.c_str(),
+        hCom = CreateFile(device.c_str(),
                         GENERIC_READ | GENERIC_WRITE,
                         0,      //  must be opened with exclusive-access
                         NULL,   //  default security attributes
@@ -64,20 +71,49 @@ bool initComm(int& argc, char **&argv)
         dcb.StopBits = ONESTOPBIT;
         SetCommState(hCom, &dcb);
 
-        // Configure Timeouts -- MAXDWORD for ReadInterval defaults to the TIMEOUT in ReadTotalTimeoutConstant
+        // Configure Timeouts -- MAXDWORD for both ReadInterval and ReadTotalTimeoutMultiplier: ReadFile() returns
+        // as soon as bytes are in, or waits up to ReadTotalTimeoutConstant for the first one (like VMIN 0/VTIME on Linux)
         timeouts.ReadIntervalTimeout = MAXDWORD;
 
         timeouts.ReadTotalTimeoutConstant = TIMEOUT_MS;
-        timeouts.ReadTotalTimeoutMultiplier = 0;
+        timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
 
         timeouts.WriteTotalTimeoutConstant = 0;
         timeouts.WriteTotalTimeoutMultiplier = 0;
         SetCommTimeouts(hCom, &timeouts);
 
         serialComm.fileDescriptor = (uint64_t) hCom;
+
+        if (LOW_LATENCY) setLowLatency(device);
         return true;
 }
 
+// Ends the exchange with `error` and goes back to MARK parity, the caller (sendMessage()) decides whether to retry
+static void failExchange(comm_error error)
+{
+    HANDLE hCom = (HANDLE)(serialComm.fileDescriptor);
+    DCB dcb;
+
+    serialComm.errorState = error;
+    serialComm.mode       = DONE;
+    serialComm.head       = 0;
+
+    GetCommState(hCom, &dcb);
+    dcb.Parity = MARKPARITY;
+    SetCommState(hCom, &dcb);
+}
+
+void commFlushInput(const comm_t& comm)
+{
+    PurgeComm((HANDLE)(comm.fileDescriptor), PURGE_RXCLEAR);
+}
+
+bool setLowLatency(const std::string& device)
+{
+    std::cout << "Low latency: set the adapter's latency timer in the Device Manager (Port Settings > Advanced) for " << device << '\n';
+    return false;
+}
+
 void commWrite()
 {
     HANDLE hCom = (HANDLE)(serialComm.fileDescriptor);
@@ -88,17 +124,20 @@ void commWrite()
     unsigned long bytesWritten;
 
     status = WriteFile(hCom, &serialComm.outBuffer[serialComm.head], bytesToBeWritten, &bytesWritten, NULL);
+    uint64_t writtenAt = monotonicNanos();
 
     // Error handling
-    if (status == -1) 
+    if (!status)
     {
-		std::cout << "ERROR: bad write in interrupt\nerrorno: " << strerror(errno) << '\n';
-		exit(1);
+		std::cout << "ERROR: bad write in interrupt\nerror: " << GetLastError() << '\n';
+        failExchange(IO_ERROR);
+        return;
 	}
     else if (bytesWritten == 0)
     {
         std::cout << "ERROR: commWrite() wrote 0 bytes\n";
-		exit(1);
+        failExchange(IO_ERROR);
+        return;
     }
 
     serialComm.head += bytesWritten;    // Advance head index pointer
@@ -106,8 +145,10 @@ void commWrite()
     // After writing first byte
     if (serialComm.head == 1)
     {
+        serialComm.txTimestamp = writtenAt;
+
         // Log the data
-        if (serialComm.verbose) logMessage(serialComm.errorState, Out, serialComm.outBuffer, serialComm.outBuffer[PACKLEN_IDX]);
+        if (serialComm.verbose) logMessage(serialComm.errorState, Out, serialComm.outBuffer, serialComm.outBuffer[PACKLEN_IDX], serialComm.txTimestamp);
 
         usleep(1000);   // Delay to avoid changing parity on the previously written byte.
 
@@ -135,54 +176,58 @@ void commRead()
 
     unsigned long bytesRead;
 
+    if (serialComm.head == 0) {serialComm.sum = 0; serialComm.summed = 0;}
+
     // Read and append incoming data to end of the input buffer
-    uint64_t timePreRead = timeSinceEpoch();
+    uint64_t timePreRead = monotonicNanos();
 	status = ReadFile(hCom, &serialComm.inBuffer[serialComm.head], sizeof(serialComm.inBuffer) - serialComm.head, &bytesRead, NULL);
-    uint64_t timeAfter =   timeSinceEpoch();
+    uint64_t timeAfter =   monotonicNanos();
+    if (status && serialComm.head == 0 && bytesRead > 0) serialComm.rxTimestamp = timeAfter;
+
+    // Line errors since the last read, parity is left out: the MARK byte starting every packet raises it
+    DWORD lineErrors = 0;
+    bool  overrun    = false;
+    if (ClearCommError(hCom, &lineErrors, NULL))
+    {
+        overrun = (lineErrors & (CE_OVERRUN | CE_RXOVER)) != 0;
+        if (overrun)                   busHealth.recordEvent(FIFO_OVERRUN);
+        if (lineErrors & CE_FRAME)     busHealth.recordEvent(FRAMING_ERROR);
+        if (overrun && serialComm.verbose) logMessage(FIFO_OVERRUN, In, serialComm.inBuffer, serialComm.inBuffer[PACKLEN_IDX], timeAfter);
+    }
     // Error handling
     if (!status)
     {
         if (GetLastError() == ERROR_TIMEOUT)
         {
-            serialComm.errorState = TIMEOUT;
-            if (serialComm.verbose) logMessage(serialComm.errorState, In, serialComm.inBuffer, serialComm.inBuffer[PACKLEN_IDX]);
+            serialComm.errorState = overrun ? FIFO_OVERRUN : busHealth.classifyTimeout();
+            if (serialComm.verbose) logMessage(serialComm.errorState, In, serialComm.inBuffer, serialComm.inBuffer[PACKLEN_IDX], timeAfter);
         }
         else
         {
-            std::cout << "ERROR: bad read \nerrorno: " << strerror(errno) << '\n';
-            exit(1);
+            std::cout << "ERROR: bad read \nerror: " << GetLastError() << '\n';
+            if (serialComm.verbose) logMessage(IO_ERROR, In, serialComm.inBuffer, serialComm.inBuffer[PACKLEN_IDX], timeAfter);
+            failExchange(IO_ERROR);
+            return;
         }
 	}
-    else if (timeAfter - timePreRead > TIMEOUT_MS)
+    else if ((timeAfter - timePreRead) / 1000000 > TIMEOUT_MS)
     {
-        serialComm.errorState = TIMEOUT;
-        if (serialComm.verbose) logMessage(serialComm.errorState, In, serialComm.inBuffer, serialComm.inBuffer[PACKLEN_IDX]);
+        serialComm.errorState = overrun ? FIFO_OVERRUN : busHealth.classifyTimeout();
+        if (serialComm.verbose) logMessage(serialComm.errorState, In, serialComm.inBuffer, serialComm.inBuffer[PACKLEN_IDX], timeAfter);
     }
-    else if (bytesRead == 0)
+    else if (bytesRead == 0)    // nothing within ReadTotalTimeoutConstant
     {
-        serialComm.errorState = EMPTY_READ;
-        if (serialComm.verbose) logMessage(serialComm.errorState, In, serialComm.inBuffer, serialComm.inBuffer[PACKLEN_IDX]);
+        serialComm.errorState = overrun ? FIFO_OVERRUN : busHealth.classifyTimeout();
+        if (serialComm.verbose) logMessage(serialComm.errorState, In, serialComm.inBuffer, serialComm.inBuffer[PACKLEN_IDX], timeAfter);
     }
     else
     {
+        busHealth.recordBytes(bytesRead);
         serialComm.head += bytesRead;
+        commFrame(serialComm);
 
-        // After all bytes have been read in
-        if (serialComm.head >= MIN_PACK_LEN && serialComm.head >= serialComm.inBuffer[PACKLEN_IDX])
-        {
-            // Check for a good CS
-            if (!validateChecksum())
-            {
-                std::cout << "ERROR_BAD_CHECKSUM 0x";
-                printBuffer(serialComm.inBuffer, serialComm.inBuffer[PACKLEN_IDX]);
-                serialComm.errorState = BAD_CHECKSUM;
-            }
-
-            // Capture logs
-            else if (serialComm.verbose) logMessage(serialComm.errorState, In, serialComm.inBuffer, serialComm.inBuffer[PACKLEN_IDX]);
-
-            serialComm.mode = DONE;
-        }
+        // A bad checksum is expected when the UART dropped bytes, report the cause instead
+        if (overrun && serialComm.errorState == BAD_CHECKSUM) serialComm.errorState = FIFO_OVERRUN;
     }
 
     if (serialComm.errorState != NONE || serialComm.mode == DONE)